@@ -0,0 +1,53 @@
+//
+// File: agent_types.c
+// Description: Contains the table that gives the type of each agent char,
+// and the function that reads the percentage of each type.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "agent_types.h"
+
+#include <stdlib.h>
+
+
+// One more than the index of each char in AGENT_CHARS
+const signed char agentTypes[256] = {
+    ['e'] = 1, ['n'] = 2, ['g'] = 3, ['w'] = 4,
+    ['h'] = 5, ['p'] = 6, ['r'] = 7, ['l'] = 8
+};
+
+
+/**
+ * parseTypes(): Reads the percentages between the commas, checking each one
+ * as it goes and their sum at the end.
+ */
+int parseTypes(const char *text, int typePercents[MAX_TYPES]) {
+
+    int numTypes = 0;
+    int sum = 0;  // Percentages read so far added together
+    char *end;
+
+    for (;;) {
+        if (numTypes == MAX_TYPES) {
+            return 0;
+        }
+
+        int percent = (int)strtol(text, &end, 10);
+        if (end == text || percent < 1 || percent > 99) {
+            return 0;
+        }
+
+        typePercents[numTypes++] = percent;
+        sum += percent;
+
+        if (*end != ',') {
+            break;
+        }
+        text = end + 1;
+    }
+
+    return *end == '\0' && numTypes >= 2 && sum == 100 ? numTypes : 0;
+}
@@ -0,0 +1,69 @@
+//
+// File: agent_types.h
+// Description: Provides the types of agents a board can hold. The first two
+// are the original endline ('e') and newline ('n') braces, and up to six
+// more brace styles can join them. Every kernel is written once for any
+// number of types, and the common case of two types gets its own copy of
+// each, built at compile time with the number of types known, so it never
+// pays for the loops over types.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for agent_types.h
+#ifndef _AGENT_TYPES_H_
+#define _AGENT_TYPES_H_
+
+// Most types of agents a board can hold
+#define MAX_TYPES 8
+
+// The char of each type of agent: endline and newline, then the GNU,
+// Whitesmiths, Horstmann, Pico, Ratliff, and Lisp brace styles
+#define AGENT_CHARS "engwhprl"
+
+// Gives the type of the agent char c, from 0, or -1 if c is not an agent
+#define AGENT_TYPE(c) (agentTypes[(unsigned char)(c)] - 1)
+
+// Set to 0 to build the kernels without their copies for two types
+#ifndef SPECIALIZE_TWO_TYPES
+#define SPECIALIZE_TWO_TYPES 1
+#endif
+
+// Marks a kernel written for any number of types, which always gets inlined
+// so that each call through BY_TYPES makes its own copy of it
+#define TYPED_KERNEL static inline __attribute__((always_inline))
+
+// Calls a typed kernel with the number of types as its last argument, passed
+// as the constant 2 when there are two so that copy has no loops over types
+#if SPECIALIZE_TWO_TYPES
+#define BY_TYPES(numTypes, kernel, ...) \
+    ((numTypes) == 2 ? kernel(__VA_ARGS__, 2) : \
+                       kernel(__VA_ARGS__, (numTypes)))
+#else
+#define BY_TYPES(numTypes, kernel, ...) kernel(__VA_ARGS__, (numTypes))
+#endif
+
+
+/**
+ * agentTypes holds one more than the type of every agent char, and 0 for
+ * every other char, so AGENT_TYPE is a single lookup.
+ */
+extern const signed char agentTypes[256];
+
+
+/**
+ * parseTypes reads the percentage of agents of each type from text like
+ * "40,30,30", one percentage per type in the order of AGENT_CHARS. There
+ * must be from 2 to MAX_TYPES of them, each in [1...99], adding up to 100.
+ *
+ * @param text          the percentages to read
+ * @param typePercents  filled with the percentage of each type
+ * @returns             the number of types, or 0 if the text was invalid
+ */
+int parseTypes(const char *text, int typePercents[MAX_TYPES]);
+
+
+// End include guard
+#endif
@@ -0,0 +1,201 @@
+//
+// File: box_filter.c
+// Description: Contains the functions for the sliding box filter. Moving to
+// the next row adds the row entering the neighborhood to the column counts
+// and takes away the one leaving it, then one pass of prefix sums across the
+// row gives the counts of every cell's neighborhood as a difference of two
+// sums.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "box_filter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * initBoxFilter(): Allocates the column counts and prefix sums of every type
+ * and of the occupied cells.
+ */
+int initBoxFilter(BoxFilter *box, int dimensions, int radius, int numTypes,
+                  int torus) {
+
+    size_t planes = (size_t)numTypes + 1;
+
+    box->dimensions = dimensions;
+    box->radius = radius;
+    box->numTypes = numTypes;
+    box->torus = torus;
+    box->centerRow = -1;
+    box->columns = malloc(planes * dimensions * sizeof(uint16_t));
+    box->prefix = malloc(planes * (dimensions + 2 * radius + 1) *
+                         sizeof(uint32_t));
+
+    if (box->columns == NULL || box->prefix == NULL) {
+        freeBoxFilter(box);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/**
+ * freeBoxFilter(): Frees the counts.
+ */
+void freeBoxFilter(BoxFilter *box) {
+
+    free(box->columns);
+    free(box->prefix);
+
+    box->columns = NULL;
+    box->prefix = NULL;
+}
+
+
+/**
+ * restartBoxFilter(): Marks the column counts as being for no row.
+ */
+void restartBoxFilter(BoxFilter *box) {
+
+    box->centerRow = -1;
+}
+
+
+/**
+ * addRow(): Adds every agent of a row to, or takes it away from, the counts
+ * of its column for its type and for the occupied cells.
+ */
+static void addRow(BoxFilter *box, const char *rowChars, int delta) {
+
+    int dimensions = box->dimensions;
+    uint16_t *occupied = box->columns + (size_t)box->numTypes * dimensions;
+
+    for (int j = 0; j < dimensions; j++) {
+        int type = AGENT_TYPE(rowChars[j]);
+
+        if (type >= 0) {
+            box->columns[(size_t)type * dimensions + j] += delta;
+            occupied[j] += delta;
+        }
+    }
+}
+
+
+/**
+ * rowIndex(): Gives the row of the board at i, which may be off the edge,
+ * wrapping it around for a torus, or -1 if a bounded board has no row there.
+ */
+static int rowIndex(const BoxFilter *box, int i) {
+
+    if (i >= 0 && i < box->dimensions) {
+        return i;
+    }
+    if (!box->torus) {
+        return -1;
+    }
+
+    return i < 0 ? i + box->dimensions : i - box->dimensions;
+}
+
+
+/**
+ * countRowTyped(): Sums the column counts of each type and of the occupied
+ * cells across the row and its halo, then takes the sums at the two edges of
+ * each cell's neighborhood. The cell itself is in its own neighborhood, so
+ * it is taken back out of both counts.
+ */
+TYPED_KERNEL void countRowTyped(BoxFilter *box, const char *rowChars,
+                                uint16_t *same, uint16_t *total,
+                                int numTypes) {
+
+    int dimensions = box->dimensions;
+    int radius = box->radius;
+    int width = 2 * radius + 1;  // Columns in a neighborhood
+    size_t stride = (size_t)dimensions + width;
+    const uint32_t *occupied = box->prefix + numTypes * stride;
+
+    for (int k = 0; k <= numTypes; k++) {
+        const uint16_t *columns = box->columns + (size_t)k * dimensions;
+        uint32_t *prefix = box->prefix + k * stride;
+        uint32_t sum = 0;
+
+        // The left halo is the last columns of a torus and empty otherwise
+        prefix[0] = 0;
+        for (int j = 0; j < radius; j++) {
+            sum += box->torus ? columns[dimensions - radius + j] : 0;
+            prefix[j + 1] = sum;
+        }
+
+        for (int j = 0; j < dimensions; j++) {
+            sum += columns[j];
+            prefix[radius + j + 1] = sum;
+        }
+
+        // And the right halo is the first columns
+        for (int j = 0; j < radius; j++) {
+            sum += box->torus ? columns[j] : 0;
+            prefix[radius + dimensions + j + 1] = sum;
+        }
+    }
+
+    for (int j = 0; j < dimensions; j++) {
+        int type = AGENT_TYPE(rowChars[j]);
+        int numOccupied = occupied[j + width] - occupied[j];
+
+        if (type < 0) {
+            same[j] = 0;
+            total[j] = numOccupied;
+            continue;
+        }
+
+        const uint32_t *prefix = box->prefix + type * stride;
+        same[j] = prefix[j + width] - prefix[j] - 1;
+        total[j] = numOccupied - 1;
+    }
+}
+
+
+/**
+ * boxCountRow(): Brings the column counts to the row, sliding them down if
+ * they were for the row above and counting every row in the neighborhood
+ * otherwise, then counts the row with the copy of the kernel for the board's
+ * number of types.
+ */
+void boxCountRow(BoxFilter *box, int dimensions,
+                 char board[dimensions][dimensions], int row, uint16_t *same,
+                 uint16_t *total) {
+
+    int radius = box->radius;
+
+    if (box->centerRow >= 0 && row == box->centerRow + 1) {
+        int entering = rowIndex(box, row + radius);
+        int leaving = rowIndex(box, row - radius - 1);
+
+        if (entering >= 0) {
+            addRow(box, board[entering], 1);
+        }
+        if (leaving >= 0) {
+            addRow(box, board[leaving], -1);
+        }
+    }
+    else if (row != box->centerRow) {
+        memset(box->columns, 0, ((size_t)box->numTypes + 1) * dimensions *
+                                sizeof(uint16_t));
+
+        for (int i = row - radius; i <= row + radius; i++) {
+            int index = rowIndex(box, i);
+
+            if (index >= 0) {
+                addRow(box, board[index], 1);
+            }
+        }
+    }
+    box->centerRow = row;
+
+    BY_TYPES(box->numTypes, countRowTyped, box, board[row], same, total);
+}
@@ -0,0 +1,103 @@
+//
+// File: box_filter.h
+// Description: Provides the neighbor counts of a square neighborhood of any
+// radius, found a row at a time with a sliding box filter. A running count
+// of each type of agent in the rows around the current one is kept for every
+// column, and the row's prefix sums of those counts are a strip of a
+// summed-area table, so the counts of any cell take two lookups no matter
+// how big the neighborhood is. The strip has a halo of radius columns on each
+// side, empty for a bounded board and wrapped around for a torus, so no cell
+// needs its neighborhood clipped to the board.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for box_filter.h
+#ifndef _BOX_FILTER_H_
+#define _BOX_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "agent_types.h"
+
+
+// Largest neighborhood radius, which keeps every count in 16 bits
+#define MAX_RADIUS 20
+
+
+/**
+ * BoxFilter holds the running column counts of one thread's pass over the
+ * rows of a board. The counts of each type come one after another, followed
+ * by the counts of every agent.
+ */
+typedef struct {
+    int dimensions;        // the size of the square board
+    int radius;            // rows and columns on each side in a neighborhood
+    int numTypes;          // types of agents in the board
+    int torus;             // boolean, true if the board wraps around
+    int centerRow;         // row the column counts are for, or -1 for none
+    uint16_t *columns;     // agents of each type in the rows within radius
+                           // of centerRow, for each column
+    uint32_t *prefix;      // the sum of the column counts before each column
+                           // of the row and its halo
+} BoxFilter;
+
+
+/**
+ * initBoxFilter allocates the counts for a board.
+ *
+ * @param box         the filter to initialize
+ * @param dimensions  the size of the square 2D array it will count in
+ * @param radius      rows and columns on each side of a cell that count as
+ *                    its neighbors, from 1 to MAX_RADIUS
+ * @param numTypes    the number of types of agents, from 2 to MAX_TYPES
+ * @param torus       1 if the board wraps around, in which case it must be at
+ *                    least 2 * radius + 1 wide, 0 if it stops at the edges
+ * @returns           1 if the counts were set up, 0 if memory ran out
+ */
+int initBoxFilter(BoxFilter *box, int dimensions, int radius, int numTypes,
+                  int torus);
+
+
+/**
+ * freeBoxFilter releases the memory held by the counts.
+ *
+ * @param box  the filter to free
+ */
+void freeBoxFilter(BoxFilter *box);
+
+
+/**
+ * restartBoxFilter forgets the column counts, which must be done whenever the
+ * board may have changed since the last row was counted.
+ *
+ * @param box  the filter to restart
+ */
+void restartBoxFilter(BoxFilter *box);
+
+
+/**
+ * boxCountRow finds the number of non-vacant neighbors of every cell in a
+ * row, and how many of them are the same type as the cell. Counting the row
+ * just after the last one counted only slides the column counts down one row,
+ * and any other row counts them again from scratch.
+ *
+ * @param box         the filter to count with
+ * @param dimensions  the size of the square 2D array given
+ * @param board       a 2D array of chars
+ * @param row         the row to count
+ * @param same        filled with the same-type neighbors of each cell in the
+ *                    row
+ * @param total       filled with the non-vacant neighbors of each cell in the
+ *                    row
+ */
+void boxCountRow(BoxFilter *box, int dimensions,
+                 char board[dimensions][dimensions], int row, uint16_t *same,
+                 uint16_t *total);
+
+
+// End include guard
+#endif
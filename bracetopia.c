@@ -1,18 +1,20 @@
 //
 // File: bracetopia.c
-// Description: Takes input via commandline using getopt to process various
-// user supplied flags as input for the program. Error messages are given if
-// incorrect, incomplete, or invalid input is provided. Then either infinite
-// or print mode is entered depending on the user input, infinite modes
-// uses ncurses to output continuously until the user stops with Control-C.
-// Print mode outputs a specified number of times and stops.
+// Description: Takes input via commandline using getopt_long to process
+// various user supplied flags as input for the program. Error messages are
+// given if incorrect, incomplete, or invalid input is provided. Then either
+// infinite or print mode is entered depending on the user input, infinite
+// modes uses ncurses to output continuously until the user stops with
+// Control-C. Print mode outputs a specified number of times and stops.
 //
 // The program simulates a city with a 2D array, that is filled with 'agents'
-// that are either endline ('e') or newline ('n'), as well as vacant ('.') 
-// chars. These agents want to be near other agents of the same type, so 
-// they have a happiness rating which is the average number of surrounding
-// cells that are the same agent as them. If this happiness os below a value
-// then the agent moves to a vacant space. This is simulated in this program.
+// that are either endline ('e') or newline ('n'), or with --types up to six
+// other brace styles, as well as vacant ('.') chars. These agents want to be
+// near other agents of the same type, so they have a happiness rating which
+// is the average number of surrounding cells, the 8 around them or every cell
+// within -r rows and columns, that are the same agent as them. If this
+// happiness os below a value then the agent moves to a vacant space. This is
+// simulated in this program.
 //
 // @author ldc1618: Luke Chelius
 //
@@ -27,9 +29,31 @@
 #include <ncurses.h>
 #include <getopt.h>
 #include <time.h>
+#include <string.h>
 
+#include "agent_types.h"
+#include "checkpoint.h"
+#include "equilibrium.h"
 #include "init_board.h"
+#include "metrics.h"
 #include "play_game.h"
+#include "sweep.h"
+#include "viewport.h"
+
+
+// Room in a print mode frame for the lines of info after the board
+#define FRAME_INFO_SIZE 512
+
+// Room for the text about the types of agents in the info lines
+#define TYPES_TEXT_SIZE 128
+
+// Room for the text about the neighborhood in the info lines
+#define NEIGHBORHOOD_TEXT_SIZE 64
+
+// Names of the move policies, as given to --policy
+static const char *policyNames[] = {
+    "first-last", "random", "nearest", "best"
+};
 
 
 /**
@@ -38,106 +62,562 @@
 void printUsage(void) {
     fprintf(stderr, "usage:\n"
             "bracetopia [-h] [-t N] [-c N] [-d dim] [-s %%str]"
-            " [-v %%vac] [-e %%end]\n");
+            " [-v %%vac] [-e %%end] [-k kernel] [-j N] [-B N] [-q]"
+            " [-p N]\n"
+            "           [-r N]"
+            " [--checkpoint FILE] [--checkpoint-every N]"
+            " [--resume FILE]\n"
+            "           [--sweep s=A:B:STEP,v=...,e=...] [--replicas N]"
+            " [--format csv|json]\n"
+            "           [--seed N] [--types %%A,%%B,...] [--torus]"
+            " [--instrument[=N]]\n"
+            "           [--metrics FILE] [--ensemble]\n"
+            "           [--policy first-last|random|nearest|best]"
+            " [--async]\n");
+}
+
+
+/**
+ * typesText writes the percentage of each type of agent for the info lines.
+ * Boards of two types just give the endline percentage.
+ *
+ * @param text          room for TYPES_TEXT_SIZE chars
+ * @param typePercents  the percentage of agents of each type
+ * @param numTypes      the number of types in the board
+ */
+void typesText(char *text, const int typePercents[], int numTypes) {
+
+    if (numTypes == 2) {
+        snprintf(text, TYPES_TEXT_SIZE, "%%end: %*d%%", 3, typePercents[0]);
+        return;
+    }
+
+    int length = snprintf(text, TYPES_TEXT_SIZE, "%%types:");
+    for (int k = 0; k < numTypes; k++) {
+        length += snprintf(text + length, TYPES_TEXT_SIZE - length,
+                           "%s %c %d%%", k > 0 ? "," : "", AGENT_CHARS[k],
+                           typePercents[k]);
+    }
+}
+
+
+/**
+ * typeHappinessText writes the average happiness of each type of agent for
+ * the info lines, in parentheses after the happiness of the board. Boards
+ * of two types leave it out.
+ *
+ * @param text           room for TYPES_TEXT_SIZE chars
+ * @param typeHappiness  the average happiness of each type
+ * @param numTypes       the number of types in the board
+ */
+void typeHappinessText(char *text, const double typeHappiness[],
+                       int numTypes) {
+
+    text[0] = '\0';
+    if (numTypes == 2) {
+        return;
+    }
+
+    int length = snprintf(text, TYPES_TEXT_SIZE, " (");
+    for (int k = 0; k < numTypes; k++) {
+        length += snprintf(text + length, TYPES_TEXT_SIZE - length,
+                           "%s%c %.3f", k > 0 ? ", " : "", AGENT_CHARS[k],
+                           typeHappiness[k]);
+    }
+    snprintf(text + length, TYPES_TEXT_SIZE - length, ")");
+}
+
+
+/**
+ * neighborhoodText writes the neighborhood radius for the info lines,
+ * whether the board is a torus, the move policy, and the update. A radius of
+ * 1 is the usual 8 neighbors and is left out, as are a bounded board, the
+ * default first and last policy, and the sync update.
+ *
+ * @param text    room for NEIGHBORHOOD_TEXT_SIZE chars
+ * @param radius  rows and columns on each side of a cell that are its
+ *                neighbors
+ * @param torus   1 if the board wraps around, 0 if it doesn't
+ * @param policy  how agents pick the vacant spot they move to
+ * @param update  how the agents of a cycle are moved
+ */
+void neighborhoodText(char *text, int radius, int torus, MovePolicy policy,
+                      UpdateMode update) {
+
+    int length = 0;
+
+    text[0] = '\0';
+    if (radius > 1) {
+        length = snprintf(text, NEIGHBORHOOD_TEXT_SIZE, ", radius: %d",
+                          radius);
+    }
+    if (torus) {
+        length += snprintf(text + length, NEIGHBORHOOD_TEXT_SIZE - length,
+                           ", torus");
+    }
+    if (policy != POLICY_FIRST_LAST) {
+        length += snprintf(text + length, NEIGHBORHOOD_TEXT_SIZE - length,
+                           ", policy: %s", policyNames[policy]);
+    }
+    if (update == UPDATE_ASYNC) {
+        snprintf(text + length, NEIGHBORHOOD_TEXT_SIZE - length, ", async");
+    }
+}
+
+
+/**
+ * checkNeighborhood checks that the kernel can count a neighborhood of the
+ * radius, switching to the box kernel for a radius above 1 unless -k asked
+ * for another one, and that a torus is wide enough that no neighborhood
+ * wraps around onto itself.
+ *
+ * @param kernel       the kernel to count with, changed to KERNEL_BOX if
+ *                     needed
+ * @param kernelGiven  1 if the kernel was given with -k, 0 otherwise
+ * @param radius       rows and columns on each side of a cell that are its
+ *                     neighbors
+ * @param torus        1 if the board wraps around, 0 if it doesn't
+ * @param dimensions   the size of the square board
+ * @returns            1 if the neighborhood can be counted, 0 if -k asked
+ *                     for a kernel that only counts the 8 cells around each
+ *                     agent or the torus is too small
+ */
+int checkNeighborhood(Kernel *kernel, int kernelGiven, int radius, int torus,
+                      int dimensions) {
+
+    if (radius > 1 && *kernel != KERNEL_BOX) {
+        if (kernelGiven) {
+            fprintf(stderr, "a radius of %d needs the box kernel\n", radius);
+            return 0;
+        }
+        *kernel = KERNEL_BOX;
+    }
+
+    if (torus && 2 * radius + 1 > dimensions) {
+        fprintf(stderr, "a radius of %d needs a torus at least %d wide\n",
+                radius, 2 * radius + 1);
+        return 0;
+    }
+
+    return 1;
+}
+
+
+/**
+ * seconds reads the monotonic clock.
+ *
+ * @returns  the current time of the monotonic clock in seconds
+ */
+double seconds(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
 }
 
 
 /**
  * printModePrint prints a 2D array of chars as well as additional information
  * about the board like the cycle it displays, the number of moves made that
- * cycle, the overall happiness rating of the board, and the dimensions,
- * strength threshold, and vacancy and endline percentage for the board.
+ * cycle, the overall happiness rating of the board and of each type when
+ * there are more than two, and the dimensions, strength threshold, vacancy
+ * and type percentages, and neighborhood for the board. The whole
+ * frame is put together in frame first and written with a single fwrite,
+ * rather than going through printf for every char.
  *
+ * @param frame              room for the text of the frame, at least
+ *                           dimensions * (dimensions + 1) + FRAME_INFO_SIZE
+ *                           chars
  * @param dimensions         the size of the square 2D array given
  * @param board              a square 2D array of chars
  * @param cycle              the cycle number the board is on (0 initially)
- * @param moves              the number of moves made during the cycle the 
- *                           board shows
- * @param happiness          the average happiness of all chars in board
+ * @param stats              the moves made during the cycle the board
+ *                           shows and the happiness of its chars
  * @param strengthThreshold  the value a chars happiness must be greater than
  *                           or equal to to stay in place
  * @param vacancy            the percentage of the board that is vacant
- * @param endline            the percentage of the remaining spots on the board
- *                           filled with endline agents
+ * @param typePercents       the percentage of the remaining spots on the board
+ *                           filled with each type of agent
+ * @param numTypes           the number of types in the board
+ * @param radius             rows and columns on each side of a cell that
+ *                           are its neighbors
+ * @param torus              1 if the board wraps around, 0 if it doesn't
+ * @param policy             how agents pick the vacant spot they move to
+ * @param update             how the agents of a cycle are moved
  */
-void printModePrint(int dimensions, char board[dimensions][dimensions],
-                    int cycle, int moves, double happiness,
-                    int strengthThreshold, int vacancy, int endline) {
-    
-    // Nested loops to print the board
+void printModePrint(char *frame, int dimensions,
+                    char board[dimensions][dimensions], int cycle,
+                    const StepStats *stats, int strengthThreshold,
+                    int vacancy, const int typePercents[], int numTypes,
+                    int radius, int torus, MovePolicy policy,
+                    UpdateMode update) {
+
+    size_t length = 0;  // Chars in the frame so far
+    char types[TYPES_TEXT_SIZE];  // Percentage of each type
+    char typeHappiness[TYPES_TEXT_SIZE];  // Happiness of each type
+    char neighborhood[NEIGHBORHOOD_TEXT_SIZE];  // Radius, torus, policy
+
+    typesText(types, typePercents, numTypes);
+    typeHappinessText(typeHappiness, stats->typeHappiness, numTypes);
+    neighborhoodText(neighborhood, radius, torus, policy, update);
+
+    // Copy the board into the frame a row at a time
     for (int i = 0; i < dimensions; i++) {
-        for (int j = 0; j < dimensions; j++) {
-            printf("%c", board[i][j]);
-        }
-        printf("\n");
+        memcpy(frame + length, board[i], dimensions);
+        length += dimensions;
+        frame[length++] = '\n';
     }
 
-    // Print additional board info for print mode
-    printf("cycle: %d\n", cycle);
-    printf("moves this cycle: %d\n", moves);
-    printf("teams\' \"happiness\": %lf\n", happiness);
-    printf("dim: %d, %%strength of preference: %*d%%, %%vacancy: %*d%%, "
-           "%%end: %*d%%\n", dimensions, 3, strengthThreshold, 3, vacancy,
-           3, endline);
+    // Add additional board info for print mode
+    length += snprintf(frame + length, FRAME_INFO_SIZE,
+                       "cycle: %d\n"
+                       "moves this cycle: %ld\n"
+                       "teams\' \"happiness\": %lf%s\n"
+                       "dim: %d, %%strength of preference: %*d%%, "
+                       "%%vacancy: %*d%%, %s%s\n", cycle, stats->moves,
+                       stats->happiness, typeHappiness, dimensions, 3,
+                       strengthThreshold, 3, vacancy, types, neighborhood);
+
+    fwrite(frame, 1, length, stdout);  // Print the whole frame at once
 }
 
 
 /**
  * infiniteModePrint prints a 2D array of chars along with additional
  * information about the board like the cycle being displayed, the number of
- * moves made this cycle, the average happiness of the board, and the
- * dimensions, strength threshold, and vacancy and endline percentages for the
- * board. This is done using curses rather than standard output.
+ * moves made this cycle, the average happiness of the board and of each type
+ * when there are more than two, and the dimensions, strength threshold,
+ * vacancy and type percentages, and neighborhood for the board. This
+ * is done using curses rather than standard output. The whole view is drawn
+ * for cycle 0, and after that only the cells the last cycle's moves changed
+ * are drawn again.
  *
+ * @param view               the part of the board shown on screen
+ * @param game               the state kept between cycles for board, holding
+ *                           the moves made this cycle
  * @param dimensions         the size of the square 2D array given
  * @param board              a 2D array of chars
  * @param cycle              the cycle number the board is on (0 initially)
- * @param moves              the number of moves made during the cycle board
- *                           currently contains
- * @param happiness          the average happiness of all chars in board
+ * @param stats              the moves made during the cycle board currently
+ *                           contains and the happiness of its chars
  * @param strengthThreshold  the value a char's happiness must be greater than
  *                           or equal to to stay in place
  * @param vacancy            the percentage of the board that is vacant
- * @param endline            the percentage of the remaining spots in the board
- *                           filled with endline agents
+ * @param typePercents       the percentage of the remaining spots in the board
+ *                           filled with each type of agent
  */
-void infiniteModePrint(int dimensions, char board[dimensions][dimensions],
-                       int cycle, int moves, double happiness, 
-                       int strengthThreshold, int vacancy, int endline) {
-    
-    move(0, 0);  // Move to begining of the window
-    
-    // Nested loops to print the board one char at a time
-    for (int i = 0; i < dimensions; i++) {
-        for (int j = 0; j < dimensions; j++) {
-            
-            printw("%c", board[i][j]);  // Prints a char
+void infiniteModePrint(Viewport *view, Game *game, int dimensions,
+                       char board[dimensions][dimensions], int cycle,
+                       const StepStats *stats, int strengthThreshold,
+                       int vacancy, const int typePercents[]) {
+
+    char types[TYPES_TEXT_SIZE];  // Percentage of each type
+    char typeHappiness[TYPES_TEXT_SIZE];  // Happiness of each type
+    char neighborhood[NEIGHBORHOOD_TEXT_SIZE];  // Radius, torus, policy
+
+    typesText(types, typePercents, game->numTypes);
+    typeHappinessText(typeHappiness, stats->typeHappiness, game->numTypes);
+    neighborhoodText(neighborhood, game->radius, game->torus,
+                     game->vacancyIndex.policy, game->update);
+
+    // Set the additional info for the board
+    snprintf(view->status, VIEWPORT_STATUS_SIZE,
+             "cycle: %d\n"
+             "moves this cycle: %ld\n"
+             "teams\' \"happiness\": %lf%s\n"
+             "dim: %d, %%strength of preference: %*d%%, %%vacancy: %*d%%, "
+             "%s%s\n"
+             "Arrows scroll, +/- zoom. Use Control-C to quit.", cycle,
+             stats->moves, stats->happiness, typeHappiness, dimensions, 3,
+             strengthThreshold, 3, vacancy, types, neighborhood);
+
+    // Draw the board and the info, then refresh to show the new output
+    if (cycle == 0) {
+        drawViewport(view, dimensions, board);
+    }
+    else {
+        drawViewportChanges(view, game->moveFrom, game->moveTo,
+                            game->moveAgent, game->numMoves);
+    }
+}
+
+
+/**
+ * writeCheckpoint saves the board and the settings it was made with to a
+ * checkpoint file, reporting to standard error if it could not be written so
+ * the run can carry on.
+ *
+ * @param path               the file to save to
+ * @param dimensions         the size of the square 2D array given
+ * @param board              a square 2D array of chars
+ * @param strengthThreshold  the value a chars happiness must be greater than
+ *                           or equal to to stay in place
+ * @param vacancy            the percentage of the board that is vacant
+ * @param typePercents       the percentage of the remaining spots on the board
+ *                           filled with each type of agent
+ * @param numTypes           the number of types in the board
+ * @param radius             rows and columns on each side of a cell that
+ *                           are its neighbors
+ * @param torus              1 if the board wraps around, 0 if it doesn't
+ * @param policy             how agents pick the vacant spot they move to
+ * @param update             how the agents of a cycle are moved
+ * @param cycle              the cycle the board is on
+ * @param moves              the number of moves made during that cycle
+ * @param rng                the generator the board was set up with
+ */
+void writeCheckpoint(const char *path, int dimensions,
+                     char board[dimensions][dimensions],
+                     int strengthThreshold, int vacancy,
+                     const int typePercents[], int numTypes, int radius,
+                     int torus, MovePolicy policy, UpdateMode update,
+                     int cycle, long moves, const Rng *rng) {
+
+    CheckpointHeader header = {
+        .strengthThreshold = strengthThreshold,
+        .vacancy = vacancy,
+        .numTypes = numTypes,
+        .cycle = cycle,
+        .radius = radius,
+        .torus = torus,
+        .policy = policy,
+        .update = update,
+        .moves = moves
+    };
+    for (int k = 0; k < numTypes; k++) {
+        header.typePercents[k] = typePercents[k];
+    }
+    memcpy(header.rngState, rng->s, sizeof(header.rngState));
+
+    if (!saveCheckpoint(path, &header, dimensions, board)) {
+        fprintf(stderr, "could not save a checkpoint to %s\n", path);
+    }
+}
+
+
+/**
+ * reportCounters writes the counters of the game to standard error as a line
+ * of JSON if --instrument turned them on. While the game runs they are
+ * written every Nth cycle, and at the end they are written once more unless
+ * the last cycle already wrote them.
+ *
+ * @param game   the state kept between cycles, with its counters
+ * @param cycle  the cycle the board is on
+ * @param every  write every Nth cycle run, or 0 to only write at the end
+ * @param last   1 if the run is over, 0 if it is still going
+ */
+void reportCounters(const Game *game, int cycle, int every, int last) {
+
+    const Counters *counters = &game->counters;
+
+    if (!counters->enabled) {
+        return;
+    }
+
+    int onInterval = every > 0 && counters->cycles > 0 &&
+                     counters->cycles % every == 0;
+
+    if (last ? !onInterval : onInterval) {
+        printCounters(counters, cycle, stderr);
+    }
+}
+
+
+/**
+ * resumable checks the settings saved in a checkpoint against the same
+ * limits the flags have, since a file can hold anything.
+ *
+ * @param header  the header of the checkpoint
+ * @returns       1 if every setting is in range, 0 otherwise
+ */
+int resumable(const CheckpointHeader *header) {
+
+    int sum = 0;  // Adds up the type percentages
+
+    for (int k = 0; k < header->numTypes; k++) {
+        if (header->typePercents[k] < 1 || header->typePercents[k] > 99) {
+            return 0;
         }
+        sum += header->typePercents[k];
+    }
+
+    return header->dimensions >= 5 &&
+           header->dimensions <= MAX_DIMENSIONS &&
+           header->strengthThreshold >= 1 &&
+           header->strengthThreshold <= 99 &&
+           header->vacancy >= 1 && header->vacancy <= 99 && sum == 100 &&
+           header->radius >= 1 && header->radius <= MAX_RADIUS &&
+           header->policy >= POLICY_FIRST_LAST &&
+           header->policy <= POLICY_BEST &&
+           header->update >= UPDATE_SYNC && header->update <= UPDATE_ASYNC;
+}
+
+
+/**
+ * settled adds the board of the next cycle to the recent ones and checks
+ * whether it has stopped changing or started repeating. The async update
+ * and the random policy draw from the generator as agents move, so with
+ * either a board coming back only means it has settled if nothing moved
+ * during the cycle.
+ *
+ * @param equilibrium  the history of recent boards
+ * @param game         the state kept between cycles, with the new hash
+ * @param moves        the moves made during the cycle
+ * @returns            1 if the board has settled, 0 otherwise
+ */
+int settled(Equilibrium *equilibrium, const Game *game, long moves) {
+
+    int repeated = checkEquilibrium(equilibrium, game->hash);
+
+    return repeated && (moves == 0 || (game->update == UPDATE_SYNC &&
+                                       game->vacancyIndex.policy !=
+                                       POLICY_RANDOM));
+}
+
+
+/**
+ * benchmarkMode runs the simulation without printing the board, for a set
+ * number of cycles or until the board stops changing or starts repeating,
+ * and reports how fast it ran along with the statistics of the final board.
+ * The readable report goes to standard error and a single JSON object with
+ * the same numbers goes to standard output.
+ *
+ * @param game               the state kept between cycles for board
+ * @param dimensions         the size of the square 2D array given
+ * @param board              a square 2D array of chars, already populated
+ * @param strengthThreshold  the value a chars happiness must be greater than
+ *                           or equal to to stay in place
+ * @param vacancy            the percentage of the board that is vacant
+ * @param typePercents       the percentage of the remaining spots on the board
+ *                           filled with each type of agent
+ * @param numCycles          the number of cycles to run, or 0 to run until
+ *                           the board repeats
+ * @param setupSeconds       the time taken to populate and shuffle the board
+ *                           and set up game
+ * @param instrumentEvery    write the counters every Nth cycle, or 0 to only
+ *                           write them at the end, if they are on
+ */
+void benchmarkMode(Game *game, int dimensions,
+                   char board[dimensions][dimensions], int strengthThreshold,
+                   int vacancy, const int typePercents[], int numCycles,
+                   double setupSeconds, int instrumentEvery) {
+
+    static const char *kernelNames[] = { "counts", "char", "packed", "box" };
+
+    int cycles = 0;  // Cycles run so far
+    long totalMoves = 0;  // Moves made over all cycles
+    double stepSeconds = 0;  // Time spent in gameStep
+
+    StepStats stats = { 0 };  // Statistics of the newest board
+    boardStats(game, dimensions, board, strengthThreshold, &stats);
+    size_t numAgents = stats.agents;  // Agents checked each cycle
+
+    Equilibrium equilibrium;  // Recent boards, to find when they repeat
+    initEquilibrium(&equilibrium, game->hash);
+    int converged = 0;  // Boolean, true once a board has repeated
+
+    double runStart = seconds();
+
+    // Run the set number of cycles, or until the board repeats
+    while (numCycles > 0 ? cycles < numCycles : !converged) {
+        double start = seconds();
+        totalMoves += gameStep(game, dimensions, board, strengthThreshold,
+                               &stats);
+        stepSeconds += seconds() - start;
+        cycles++;
+        reportCounters(game, cycles, instrumentEvery, 0);
 
-        printw("\n");  // Move to new line after each row prints
+        // Only the first repeat is reported
+        if (!converged) {
+            converged = settled(&equilibrium, game, stats.moves);
+        }
     }
 
-    // Print additional info for the board
-    printw("cycle: %d\n", cycle);
-    printw("moves this cycle: %d\n", moves);
-    printw("teams\' \"happiness\": %lf\n", happiness);
-    printw("dim: %d, %%strength of preference: %*d%%, %%vacancy: %*d%%, "
-           "%%end: %*d%%\n", dimensions, 3, strengthThreshold, 3, vacancy,
-           3, endline);
-    printw("Use Control-C to quit.");
+    double runSeconds = seconds() - runStart;
+    reportCounters(game, cycles, instrumentEvery, 1);
+    double cyclesPerSecond = runSeconds > 0 ? cycles / runSeconds : 0;
+    double updatesPerSecond = cyclesPerSecond * numAgents;
+
+    char types[TYPES_TEXT_SIZE];  // Percentage of each type
+    char neighborhood[NEIGHBORHOOD_TEXT_SIZE];  // Radius, torus, policy
+    typesText(types, typePercents, game->numTypes);
+    neighborhoodText(neighborhood, game->radius, game->torus,
+                     game->vacancyIndex.policy, game->update);
+
+    // Readable report
+    fprintf(stderr, "dim: %d, %%strength of preference: %d%%, %%vacancy: %d%%, "
+            "%s%s, kernel: %s, threads: %d\n", dimensions, strengthThreshold,
+            vacancy, types, neighborhood, kernelNames[game->kernel],
+            game->threads);
+    fprintf(stderr, "agents: %zu, cycles: %d, total moves: %ld, "
+            "equilibrium: %s", numAgents, cycles, totalMoves,
+            converged ? "yes" : "no");
+    if (converged) {
+        fprintf(stderr, " (cycle %d, period %d)", equilibrium.convergedCycle,
+                equilibrium.period);
+    }
+    fprintf(stderr, "\n");
+    fprintf(stderr, "setup: %.6f s, run: %.6f s (gameStep %.6f s)\n",
+            setupSeconds, runSeconds, stepSeconds);
+    fprintf(stderr, "cycles/sec: %.3f, agent-updates/sec: %.0f, "
+            "final happiness: %lf, unhappy: %zu\n", cyclesPerSecond,
+            updatesPerSecond, stats.happiness, stats.unhappy);
+    fprintf(stderr, "happiness histogram:");
+    for (int b = 0; b < HAPPINESS_BUCKETS; b++) {
+        fprintf(stderr, " %zu", stats.histogram[b]);
+    }
+    fprintf(stderr, "\nhappiness by type:");
+    for (int k = 0; k < game->numTypes; k++) {
+        fprintf(stderr, " %c %lf", AGENT_CHARS[k], stats.typeHappiness[k]);
+    }
+    fprintf(stderr, "\n");
 
-    refresh();  // Refresh screen to show new output
+    // Machine-readable report
+    printf("{\"dimensions\": %d, \"strength\": %d, \"vacancy\": %d, "
+           "\"endline\": %d, \"radius\": %d, \"torus\": %s, "
+           "\"kernel\": \"%s\", \"policy\": \"%s\", \"update\": \"%s\", "
+           "\"threads\": %d, "
+           "\"agents\": %zu, \"cycles\": %d, \"total_moves\": %ld, "
+           "\"equilibrium\": %s, \"converged_cycle\": %d, "
+           "\"period\": %d, \"setup_seconds\": %.6f, "
+           "\"run_seconds\": %.6f, \"game_step_seconds\": %.6f, "
+           "\"cycles_per_sec\": %.3f, \"agent_updates_per_sec\": %.0f, "
+           "\"final_happiness\": %.6f, \"final_unhappy\": %zu, "
+           "\"happiness_histogram\": [",
+           dimensions, strengthThreshold, vacancy, typePercents[0],
+           game->radius, game->torus ? "true" : "false",
+           kernelNames[game->kernel], policyNames[game->vacancyIndex.policy],
+           game->update == UPDATE_ASYNC ? "async" : "sync", game->threads,
+           numAgents, cycles, totalMoves, converged ? "true" : "false",
+           converged ? equilibrium.convergedCycle : -1,
+           converged ? equilibrium.period : 0, setupSeconds,
+           runSeconds, stepSeconds, cyclesPerSecond, updatesPerSecond,
+           stats.happiness, stats.unhappy);
+    for (int b = 0; b < HAPPINESS_BUCKETS; b++) {
+        printf("%s%zu", b > 0 ? ", " : "", stats.histogram[b]);
+    }
+    printf("], \"type_percents\": [");
+    for (int k = 0; k < game->numTypes; k++) {
+        printf("%s%d", k > 0 ? ", " : "", typePercents[k]);
+    }
+    printf("], \"type_happiness\": [");
+    for (int k = 0; k < game->numTypes; k++) {
+        printf("%s%.6f", k > 0 ? ", " : "", stats.typeHappiness[k]);
+    }
+    printf("]}\n");
 }
 
 
 /**
- * main uses getopt to process flags from the commandline supplied by the user
- * in order to take possible input for the number of cycles for print mode,
- * the size of the 2D array board, the happiness level threshold, the
- * percentage of vacant spaces, the percentage of endline spaces, the sleep
- * time for infinite mode, or to display a help screen. It then populates
- * and shuffles the board and enters print mode or infinite mode depending
- * on the flags given from the commandline.
+ * main uses getopt_long to process flags from the commandline supplied by the
+ * user in order to take possible input for the number of cycles for print
+ * mode, the size of the 2D array board, the happiness level threshold, the
+ * percentage of vacant spaces, the percentage of endline spaces or of each
+ * type of agent, the neighborhood radius, whether the board wraps around,
+ * the sleep time for infinite mode,
+ * or to display a help screen. It then populates and shuffles the board, or
+ * loads it from a checkpoint, and enters print mode or infinite mode
+ * depending on the flags given from the commandline.
  *
  * @param argc  the total number of command line args given, at least 1 as it
  *              always includes the program name
@@ -149,18 +629,68 @@ void infiniteModePrint(int dimensions, char board[dimensions][dimensions],
  */
 int main(int argc, char *argv[]) {
     
-    int opt;  // Variable used for getopt
+    int opt;  // Variable used for getopt_long
     int temp;  // Temporary variable to get flag input
-    int time = 900000;  // Default sleep time for infinite mode
+    int delay = 900000;  // Default sleep time for infinite mode
     int infiniteMode = 1;  // Boolean, true as default is infinite mode
-    int numCycles;  // Holds the number of cycles to do if in print mode
+    int numCycles = 0;  // Holds the number of cycles to do if in print mode
     int dimensions = 15;  // Default size for board
     int strengthThreshold = 50;  // Default happiness threshold
     int vacant = 20;  // Default vacancy percentage
     int endline = 60;  // Default endline agent percentage
+    int typePercents[MAX_TYPES];  // Percentage of agents of each type
+    int numTypes = 0;  // Types given with --types, or 0 for -e's two
+    Kernel kernel = KERNEL_COUNTS;  // Default way to count neighbors
+    int kernelGiven = 0;  // Boolean, true if -k picked the kernel
+    int radius = 1;  // Default neighborhood, the 8 cells around each agent
+    int torus = 0;  // Boolean, true if --torus wraps the board around
+    MovePolicy policy = POLICY_FIRST_LAST;  // Default way to pick vacancies
+    UpdateMode update = UPDATE_SYNC;  // Default way to move a cycle's agents
+    int threads = 1;  // Default number of threads for gameMove
+    int timed = 0;  // Boolean, true if -j was given to time gameStep
+    int benchmark = 0;  // Boolean, true if -B was given for benchmark mode
+    int benchCycles = 0;  // Cycles to benchmark, 0 runs until nobody moves
+    int stopAtEquilibrium = 0;  // Boolean, true if -q was given
+    int printEvery = 1;  // Print mode prints every Nth cycle, 0 for the last
+    const char *checkpointPath = NULL;  // File to save the board to, if any
+    int checkpointEvery = 0;  // Save every Nth cycle, 0 only saves at the end
+    const char *resumePath = NULL;  // Checkpoint to start from, if any
+    const char *sweepText = NULL;  // Ranges to sweep over, if any
+    int replicas = 1;  // Runs of each combination in a sweep
+    int ensemble = 0;  // Boolean, true if a sweep's replicas run in lockstep
+    int json = 0;  // Boolean, true if sweep rows are written as JSON
+    uint64_t seed = time(NULL);  // Seed of the generator for the board
+    int instrument = 0;  // Boolean, true if --instrument turned on counters
+    int instrumentEvery = 0;  // Write them every Nth cycle, 0 only at the end
+    const char *metricsPath = NULL;  // File to write a row per cycle to
+
+    // Flags that only have a long name
+    enum {
+        OPT_CHECKPOINT = 256, OPT_CHECKPOINT_EVERY, OPT_RESUME, OPT_SWEEP,
+        OPT_REPLICAS, OPT_FORMAT, OPT_SEED, OPT_TYPES, OPT_TORUS,
+        OPT_INSTRUMENT, OPT_METRICS, OPT_ENSEMBLE, OPT_POLICY, OPT_ASYNC
+    };
+    static const struct option longOptions[] = {
+        { "checkpoint", required_argument, NULL, OPT_CHECKPOINT },
+        { "checkpoint-every", required_argument, NULL, OPT_CHECKPOINT_EVERY },
+        { "resume", required_argument, NULL, OPT_RESUME },
+        { "sweep", required_argument, NULL, OPT_SWEEP },
+        { "replicas", required_argument, NULL, OPT_REPLICAS },
+        { "ensemble", no_argument, NULL, OPT_ENSEMBLE },
+        { "policy", required_argument, NULL, OPT_POLICY },
+        { "async", no_argument, NULL, OPT_ASYNC },
+        { "format", required_argument, NULL, OPT_FORMAT },
+        { "seed", required_argument, NULL, OPT_SEED },
+        { "types", required_argument, NULL, OPT_TYPES },
+        { "torus", no_argument, NULL, OPT_TORUS },
+        { "instrument", optional_argument, NULL, OPT_INSTRUMENT },
+        { "metrics", required_argument, NULL, OPT_METRICS },
+        { NULL, 0, NULL, 0 }
+    };
 
     // While loop runs until no more commandline args are left
-    while ((opt = getopt(argc, argv, "ht:c:d:s:v:e:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "ht:c:d:s:v:e:k:j:B:qp:r:",
+                              longOptions, NULL)) != -1) {
 
         // Switch statement to process different flags from the commandline
         switch(opt) {
@@ -181,7 +711,61 @@ int main(int argc, char *argv[]) {
                     "preference.\n"
                     "'-v %%vac'   20        -v30      percent vacancies.\n"
                     "'-e %%endl'  60        -e75      percent Endline "
-                    "braces. Others want Newline.\n");
+                    "braces. Others want Newline.\n"
+                    "'-k kernel' counts    -k packed neighbor counting: "
+                    "counts, char, packed, or box.\n"
+                    "'-j N'      1         -j 8      threads per cycle, "
+                    "times print mode.\n"
+                    "'-B N'      NA        -B 100    benchmark N cycles, 0 "
+                    "runs to equilibrium.\n"
+                    "'-q'        NA        -q        quit once the board "
+                    "stops changing or repeats.\n"
+                    "'-p N'      1         -p 10     print every Nth cycle, "
+                    "0 prints only the last.\n"
+                    "'-r N'      1         -r 3      neighborhood radius, "
+                    "above 1 uses the box kernel.\n"
+                    "'--checkpoint FILE'     NA          save the board to "
+                    "FILE when the run ends.\n"
+                    "'--checkpoint-every N'  0           also save it every "
+                    "Nth cycle.\n"
+                    "'--resume FILE'         NA          start from a "
+                    "checkpoint, with its dim, %%str, %%vac,\n"
+                    "                                    %%endl, radius, "
+                    "torus, and cycle.\n"
+                    "'--sweep RANGES'        NA          run every combination "
+                    "of s=, v=, and e= ranges\n"
+                    "                                    like s=30:70:10,v=20, "
+                    "-c caps the cycles.\n"
+                    "'--replicas N'          1           runs of each "
+                    "combination in a sweep.\n"
+                    "'--ensemble'            NA          run a sweep's "
+                    "replicas 64 at a time bit-sliced.\n"
+                    "'--format F'            csv         sweep rows as csv or "
+                    "json.\n"
+                    "'--seed N'              time        seed for shuffling, "
+                    "the same seed gives the same board.\n"
+                    "'--types %%A,%%B,...'     NA          percent of agents "
+                    "of each type, 2 to 8 types\n"
+                    "                                    " AGENT_CHARS
+                    " adding up to 100, in place of -e.\n"
+                    "'--torus'               NA          wrap the board around "
+                    "so edge cells have 8 neighbors.\n"
+                    "'--instrument[=N]'      NA          write counts and "
+                    "phase times as JSON to stderr\n"
+                    "                                    at the end, and every "
+                    "Nth cycle if N is given.\n"
+                    "'--metrics FILE'        NA          write each cycle's "
+                    "moves and happiness to FILE\n"
+                    "                                    as CSV in print or "
+                    "infinite mode.\n"
+                    "'--policy P'            first-last  where agents move: "
+                    "first-last, random, nearest,\n"
+                    "                                    or best, which needs "
+                    "the counts kernel.\n"
+                    "'--async'               NA          move unhappy agents "
+                    "one at a time, drawn at\n"
+                    "                                    random, with the "
+                    "counts kernel.\n");
 
             // Ends the program returning EXIT_SUCCESS
             return EXIT_SUCCESS;
@@ -192,7 +776,7 @@ int main(int argc, char *argv[]) {
         case 't':
             temp = (int)strtol(optarg, NULL, 10);
             if (temp > 0) {
-                time = temp;
+                delay = temp;
             }
             break;
         
@@ -215,18 +799,18 @@ int main(int argc, char *argv[]) {
             }
             break;
         
-        // Dimension flag, accepted if between 5 and 39 (inclusive), determines
-        // the size of the 2D array board
+        // Dimension flag, accepted if between 5 and MAX_DIMENSIONS
+        // (inclusive), determines the size of the 2D array board
         case 'd':
             temp = (int)strtol(optarg, NULL, 10);
-            if (temp >= 5 && temp <= 39) {
+            if (temp >= 5 && temp <= MAX_DIMENSIONS) {
                 dimensions = temp;
             }
             // Prints an error message if the flag's value isn't in the range,
             // and returns EXIT_FAILURE to end the program
             else {
-                fprintf(stderr, "dimension (%d) must be a value in [5...39]\n",
-                        temp);
+                fprintf(stderr, "dimension (%d) must be a value in [5...%d]\n",
+                        temp, MAX_DIMENSIONS);
                 printUsage();
                 return (1 + EXIT_FAILURE);
             }
@@ -286,6 +870,270 @@ int main(int argc, char *argv[]) {
             }
             break;
 
+        // Kernel flag, accepted if it names one of the ways to count
+        // neighbors, all of which give the same results
+        case 'k':
+            if (strcmp(optarg, "counts") == 0) {
+                kernel = KERNEL_COUNTS;
+            }
+            else if (strcmp(optarg, "char") == 0) {
+                kernel = KERNEL_CHAR;
+            }
+            else if (strcmp(optarg, "packed") == 0) {
+                kernel = KERNEL_PACKED;
+            }
+            else if (strcmp(optarg, "box") == 0) {
+                kernel = KERNEL_BOX;
+            }
+            // Prints an error message if the kernel isn't known, and returns
+            // EXIT_FAILURE to end the program
+            else {
+                fprintf(stderr, "kernel (%s) must be one of counts, char, "
+                        "packed, or box\n", optarg);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            kernelGiven = 1;
+            break;
+
+        // Threads flag, accepted if between 1 and MAX_THREADS (inclusive),
+        // determines how many threads look for unhappy agents each cycle,
+        // and reports how long print mode spent in gameStep
+        case 'j':
+            temp = (int)strtol(optarg, NULL, 10);
+            if (temp >= 1 && temp <= MAX_THREADS) {
+                threads = temp;
+                timed = 1;
+            }
+            // Prints an error message if the flag's value isn't in the range,
+            // and returns EXIT_FAILURE to end the program
+            else {
+                fprintf(stderr, "threads (%d) must be a value in [1...%d]\n",
+                        temp, MAX_THREADS);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+
+        // Benchmark flag, accepted if greater than or equal to 0, runs the
+        // simulation without output for that many cycles, or until nobody
+        // moves if 0, and reports how fast it ran
+        case 'B':
+            temp = (int)strtol(optarg, NULL, 10);
+            if (temp >= 0) {
+                benchmark = 1;
+                benchCycles = temp;
+            }
+            // Prints an error message if the flag has an invalid value, and
+            // returns EXIT_FAILURE to end the program
+            else {
+                fprintf(stderr, "benchmark count (%d) must be a non-negative "
+                        "integer.\n", temp);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+
+        // Equilibrium flag, stops print or infinite mode once the board is
+        // the same as one of the recent boards, since nothing new can happen
+        // after that
+        case 'q':
+            stopAtEquilibrium = 1;
+            break;
+
+        // Print interval flag, print mode only prints every Nth cycle and
+        // the last one, or only the last one for 0
+        case 'p':
+            temp = (int)strtol(optarg, NULL, 10);
+            if (temp >= 0) {
+                printEvery = temp;
+            }
+            // Prints an error message if the flag has an invalid value, and
+            // returns EXIT_FAILURE to end the program
+            else {
+                fprintf(stderr, "print interval (%d) must be a non-negative "
+                        "integer.\n", temp);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+
+        // Radius flag, accepted if between 1 and MAX_RADIUS (inclusive),
+        // determines how many rows and columns on each side of an agent are
+        // its neighbors
+        case 'r':
+            temp = (int)strtol(optarg, NULL, 10);
+            if (temp >= 1 && temp <= MAX_RADIUS) {
+                radius = temp;
+            }
+            // Prints an error message if the flag's value isn't in the range,
+            // and returns EXIT_FAILURE to end the program
+            else {
+                fprintf(stderr, "radius (%d) must be a value in [1...%d]\n",
+                        temp, MAX_RADIUS);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+
+        // Checkpoint flag, saves the board to the file when the run ends
+        case OPT_CHECKPOINT:
+            checkpointPath = optarg;
+            break;
+
+        // Checkpoint interval flag, also saves the board every Nth cycle so
+        // a run that is stopped can be picked up close to where it was
+        case OPT_CHECKPOINT_EVERY:
+            temp = (int)strtol(optarg, NULL, 10);
+            if (temp >= 0) {
+                checkpointEvery = temp;
+            }
+            // Prints an error message if the flag has an invalid value, and
+            // returns EXIT_FAILURE to end the program
+            else {
+                fprintf(stderr, "checkpoint interval (%d) must be a "
+                        "non-negative integer.\n", temp);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+
+        // Resume flag, starts from the board saved in a checkpoint
+        case OPT_RESUME:
+            resumePath = optarg;
+            break;
+
+        // Sweep flag, runs every combination of the ranges given instead of
+        // a single board, checked once the other flags are known
+        case OPT_SWEEP:
+            sweepText = optarg;
+            break;
+
+        // Replicas flag, runs each combination of a sweep N times
+        case OPT_REPLICAS:
+            temp = (int)strtol(optarg, NULL, 10);
+            if (temp >= 1) {
+                replicas = temp;
+            }
+            // Prints an error message if the flag has an invalid value, and
+            // returns EXIT_FAILURE to end the program
+            else {
+                fprintf(stderr, "replicas (%d) must be a positive integer.\n",
+                        temp);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+
+        // Ensemble flag, plays the replicas of each combination of a sweep
+        // in lockstep, checked once the other flags are known
+        case OPT_ENSEMBLE:
+            ensemble = 1;
+            break;
+
+        // Format flag, picks CSV or JSON rows for a sweep
+        case OPT_FORMAT:
+            if (strcmp(optarg, "csv") == 0 || strcmp(optarg, "json") == 0) {
+                json = strcmp(optarg, "json") == 0;
+            }
+            // Prints an error message if the format isn't known, and
+            // returns EXIT_FAILURE to end the program
+            else {
+                fprintf(stderr, "format (%s) must be csv or json\n", optarg);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+
+        // Seed flag, any 64-bit number, so runs can be repeated exactly
+        case OPT_SEED: {
+            char *end;
+            seed = strtoull(optarg, &end, 0);
+            // Prints an error message if the flag isn't a number, and
+            // returns EXIT_FAILURE to end the program
+            if (end == optarg || *end != '\0') {
+                fprintf(stderr, "seed (%s) must be a non-negative integer.\n",
+                        optarg);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+        }
+
+        // Types flag, percentages of 2 to MAX_TYPES types of agents adding
+        // up to 100, which replaces the endline percentage from -e
+        case OPT_TYPES:
+            numTypes = parseTypes(optarg, typePercents);
+            // Prints an error message if the percentages aren't valid, and
+            // returns EXIT_FAILURE to end the program
+            if (numTypes == 0) {
+                fprintf(stderr, "types (%s) must be 2 to %d percentages in "
+                        "[1...99] adding up to 100\n", optarg, MAX_TYPES);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+
+        // Torus flag, joins each edge of the board to the opposite one
+        case OPT_TORUS:
+            torus = 1;
+            break;
+
+        // Instrument flag, counts and times the work done each cycle, and
+        // writes it every Nth cycle if N is given as well as at the end
+        case OPT_INSTRUMENT:
+            temp = optarg != NULL ? (int)strtol(optarg, NULL, 10) : 0;
+            // Prints an error message if the counters were left out of the
+            // build or the flag has an invalid value, and returns
+            // EXIT_FAILURE to end the program
+            if (!COUNTERS) {
+                fprintf(stderr, "instrument needs a build without "
+                        "-DCOUNTERS=0\n");
+                return (1 + EXIT_FAILURE);
+            }
+            if (temp < 0) {
+                fprintf(stderr, "instrument interval (%d) must be a "
+                        "non-negative integer.\n", temp);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            instrument = 1;
+            instrumentEvery = temp;
+            break;
+
+        // Policy flag, accepted if it names one of the ways to pick the
+        // vacant spot an agent moves to
+        case OPT_POLICY: {
+            int found = 0;  // Boolean, true once the name matches a policy
+            for (int p = POLICY_FIRST_LAST; p <= POLICY_BEST && !found;
+                 p++) {
+                if (strcmp(optarg, policyNames[p]) == 0) {
+                    policy = p;
+                    found = 1;
+                }
+            }
+            // Prints an error message if the policy isn't known, and
+            // returns EXIT_FAILURE to end the program
+            if (!found) {
+                fprintf(stderr, "policy (%s) must be one of first-last, "
+                        "random, nearest, or best\n", optarg);
+                printUsage();
+                return (1 + EXIT_FAILURE);
+            }
+            break;
+        }
+
+        // Async flag, moves the unhappy agents one at a time in random order
+        // instead of all at once
+        case OPT_ASYNC:
+            update = UPDATE_ASYNC;
+            break;
+
+        // Metrics flag, writes a CSV row about every cycle to the file
+        case OPT_METRICS:
+            metricsPath = optarg;
+            break;
+
         // Default case runs if an invalid or incomplete flag is passed, prints
         // the usage and returns EXIT_FAILURE to end the program
         default:
@@ -294,15 +1142,225 @@ int main(int argc, char *argv[]) {
         }
     }
     
-    char board[dimensions][dimensions];  // Create the board of size dimensions
+    // Without --types there are endline and newline agents, split by -e
+    if (numTypes == 0) {
+        numTypes = 2;
+        typePercents[0] = endline;
+        typePercents[1] = 100 - endline;
+    }
+
+    // Only a sweep has replicas to play in lockstep
+    if (ensemble && sweepText == NULL) {
+        fprintf(stderr, "ensemble only works with --sweep\n");
+        printUsage();
+        return (1 + EXIT_FAILURE);
+    }
+
+    // Sweep mode replaces the other modes if --sweep was given, with the
+    // -s, -v, and -e values used for any parameter it leaves out
+    if (sweepText != NULL) {
+        if (numTypes != 2) {
+            fprintf(stderr, "sweeps only have two types, use e= instead of "
+                    "--types\n");
+            printUsage();
+            return (1 + EXIT_FAILURE);
+        }
 
-    populateBoard(dimensions, board, vacant, endline);  // Fill board
-    shuffle(dimensions, board);  // Shuffle the chars in board
+        if (!checkNeighborhood(&kernel, kernelGiven, radius, torus,
+                               dimensions)) {
+            printUsage();
+            return (1 + EXIT_FAILURE);
+        }
 
-    int cycle = 0;  // Variable to track the current cycle
-    int moves = 0;  // Variable to track the number of moves made this cycle
-    // Variable holds the board's happiness rating for this cycle
-    double happiness = getBoardHappiness(dimensions, board);
+        if (policy != POLICY_FIRST_LAST || update != UPDATE_SYNC) {
+            fprintf(stderr, "sweeps only move agents with the first-last "
+                    "policy and the sync update\n");
+            printUsage();
+            return (1 + EXIT_FAILURE);
+        }
+
+        if (ensemble && radius != 1) {
+            fprintf(stderr, "ensembles only count the 8 neighbors of "
+                    "radius 1\n");
+            printUsage();
+            return (1 + EXIT_FAILURE);
+        }
+
+        Sweep sweep = {
+            .dimensions = dimensions,
+            .radius = radius,
+            .torus = torus,
+            .kernel = kernel,
+            .strength = { strengthThreshold, strengthThreshold, 1 },
+            .vacancy = { vacant, vacant, 1 },
+            .endline = { endline, endline, 1 },
+            .replicas = replicas,
+            .ensemble = ensemble,
+            .maxCycles = infiniteMode ? SWEEP_MAX_CYCLES : numCycles,
+            .threads = timed ? threads : (int)sysconf(_SC_NPROCESSORS_ONLN),
+            .json = json,
+            .seed = seed
+        };
+
+        if (!parseSweep(sweepText, &sweep)) {
+            fprintf(stderr, "sweep (%s) must be ranges like "
+                    "s=30:70:10,v=10:30:5,e=60 in [1...99]\n", sweepText);
+            printUsage();
+            return (1 + EXIT_FAILURE);
+        }
+
+        // Fall back to one thread if the processors can't be counted
+        if (sweep.threads < 1) {
+            sweep.threads = 1;
+        }
+
+        if (!runSweep(&sweep, stdout)) {
+            fprintf(stderr, "not enough memory to finish the sweep\n");
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    double setupStart = seconds();  // Start of the setup for benchmarks
+    Rng rng;  // Generator the board is set up with
+    seedRng(&rng, seed);
+    int startCycle = 0;  // Cycle the board starts on
+    long startMoves = 0;  // Moves made during that cycle
+
+    // A checkpoint replaces the size and percentages given, since the board
+    // in it already has them
+    Checkpoint checkpoint;
+    if (resumePath != NULL) {
+        if (!openCheckpoint(&checkpoint, resumePath) ||
+            !resumable(checkpoint.header)) {
+            fprintf(stderr, "%s is not a checkpoint that can be resumed\n",
+                    resumePath);
+            closeCheckpoint(&checkpoint);
+            return EXIT_FAILURE;
+        }
+
+        dimensions = checkpoint.header->dimensions;
+        strengthThreshold = checkpoint.header->strengthThreshold;
+        vacant = checkpoint.header->vacancy;
+        numTypes = checkpoint.header->numTypes;
+        radius = checkpoint.header->radius;
+        torus = checkpoint.header->torus != 0;
+        policy = checkpoint.header->policy;
+        update = checkpoint.header->update;
+        for (int k = 0; k < numTypes; k++) {
+            typePercents[k] = checkpoint.header->typePercents[k];
+        }
+        startCycle = checkpoint.header->cycle;
+        startMoves = checkpoint.header->moves;
+        memcpy(rng.s, checkpoint.header->rngState, sizeof(rng.s));
+    }
+
+    // The neighborhood, policy, and update may have come from the
+    // checkpoint, and the best policy and the async update read the counts
+    // only the counts kernel keeps. A board moved by the generator, with the
+    // async update or the random policy, can keep changing forever, so it
+    // is only benchmarked for a set number of cycles
+    int drawn = update == UPDATE_ASYNC || policy == POLICY_RANDOM;
+    if (!checkNeighborhood(&kernel, kernelGiven, radius, torus, dimensions) ||
+        (policy == POLICY_BEST && kernel != KERNEL_COUNTS) ||
+        (update == UPDATE_ASYNC && kernel != KERNEL_COUNTS) ||
+        (drawn && benchmark && benchCycles == 0)) {
+        if (policy == POLICY_BEST && kernel != KERNEL_COUNTS) {
+            fprintf(stderr, "the best policy needs the counts kernel and a "
+                    "radius of 1\n");
+        }
+        else if (update == UPDATE_ASYNC && kernel != KERNEL_COUNTS) {
+            fprintf(stderr, "the async update needs the counts kernel and a "
+                    "radius of 1\n");
+        }
+        else if (drawn && benchmark && benchCycles == 0) {
+            fprintf(stderr, "the %s may never settle, so -B needs a count "
+                    "of cycles\n", update == UPDATE_ASYNC ?
+                    "async update" : "random policy");
+        }
+        if (resumePath != NULL) {
+            closeCheckpoint(&checkpoint);
+        }
+        printUsage();
+        return (1 + EXIT_FAILURE);
+    }
+
+    // Create the board of size dimensions, kept for the whole run
+    char (*board)[dimensions] = allocBoard(dimensions);
+    if (board == NULL) {
+        fprintf(stderr, "not enough memory for a %dx%d board\n", dimensions,
+                dimensions);
+        if (resumePath != NULL) {
+            closeCheckpoint(&checkpoint);
+        }
+        return EXIT_FAILURE;
+    }
+
+    if (resumePath != NULL) {
+        loadCheckpoint(&checkpoint, dimensions, board);  // Unpack the board
+        closeCheckpoint(&checkpoint);
+    }
+    else {
+        // Fill board, then shuffle the chars in board
+        populateBoard(dimensions, board, vacant, typePercents, numTypes,
+                      threads);
+        if (!shuffle(dimensions, board, &rng, threads)) {
+            fprintf(stderr, "not enough memory for a %dx%d board\n",
+                    dimensions, dimensions);
+            freeBoard(dimensions, board);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Set up the state gameMove keeps between cycles
+    Game game;
+    if (!initGame(&game, dimensions, board, numTypes, radius, torus, kernel,
+                  threads)) {
+        fprintf(stderr, "not enough memory for a %dx%d board\n", dimensions,
+                dimensions);
+        freeBoard(dimensions, board);
+        return EXIT_FAILURE;
+    }
+    if (!setMovePolicy(&game, policy, &rng) ||
+        !setUpdateMode(&game, update, &rng)) {
+        fprintf(stderr, "not enough memory for a %dx%d board\n", dimensions,
+                dimensions);
+        freeGame(&game);
+        freeBoard(dimensions, board);
+        return EXIT_FAILURE;
+    }
+    initCounters(&game.counters, instrument);
+
+    // Benchmark mode replaces the other modes if -B was given
+    if (benchmark) {
+        benchmarkMode(&game, dimensions, board, strengthThreshold, vacant,
+                      typePercents, benchCycles, seconds() - setupStart,
+                      instrumentEvery);
+
+        freeGame(&game);
+        freeBoard(dimensions, board);
+        return EXIT_SUCCESS;
+    }
+
+    int cycle = startCycle;  // Variable to track the current cycle
+    // Holds the moves made this cycle and the board's happiness rating
+    StepStats stats = { 0 };
+    boardStats(&game, dimensions, board, strengthThreshold, &stats);
+    stats.moves = startMoves;
+
+    Equilibrium equilibrium;  // Recent boards, to find when they repeat
+    initEquilibrium(&equilibrium, game.hash);
+    int converged = 0;  // Boolean, true once -q was given and a board repeats
+
+    // Start the writer of the per-cycle rows if --metrics was given
+    Metrics metrics;
+    if (metricsPath != NULL && !openMetrics(&metrics, metricsPath, numTypes)) {
+        fprintf(stderr, "could not open %s to write metrics\n", metricsPath);
+        freeGame(&game);
+        freeBoard(dimensions, board);
+        return EXIT_FAILURE;
+    }
 
     // If infinite mode is selected (-c flag is not used), enter infinite mode
     if (infiniteMode) {
@@ -310,40 +1368,145 @@ int main(int argc, char *argv[]) {
         initscr();  // Begin curses mode by initializing the screen
         refresh();  // Refresh the screen
 
-        // While loop to run infinitely until user stops with Control-C
+        Viewport view;  // Part of the board shown, starting at the top left
+        initViewport(&view, dimensions);
+
+        // While loop to run infinitely until user stops with Control-C, or
+        // the board repeats if -q was given
         while (infiniteMode) {
             
             // Print out the board and info using curses
-            infiniteModePrint(dimensions, board, cycle, moves, happiness,
-                              strengthThreshold, vacant, endline);
-            usleep(time);  // 'Sleep' for amount of time for readability
+            infiniteModePrint(&view, &game, dimensions, board, cycle, &stats,
+                              strengthThreshold, vacant, typePercents);
+            if (metricsPath != NULL) {
+                pushMetrics(&metrics, cycle, &stats);
+            }
+
+            // Save the board every Nth cycle, and when the board repeats
+            if (checkpointPath != NULL &&
+                ((checkpointEvery > 0 && cycle > startCycle &&
+                  cycle % checkpointEvery == 0) || converged)) {
+                writeCheckpoint(checkpointPath, dimensions, board,
+                                strengthThreshold, vacant, typePercents,
+                                numTypes, radius, torus, policy, update,
+                                cycle, stats.moves, &rng);
+            }
+
+            // Nothing new can happen once the board repeats
+            if (converged) {
+                break;
+            }
+            // 'Sleep' for amount of time for readability, scrolling and
+            // zooming the view if keys are pressed in the meantime
+            waitViewport(&view, dimensions, board, delay);
 
             cycle++;  // Increment cycle number
-            // Generate the next cycle and store the number of moves made
-            moves = gameMove(dimensions, board, strengthThreshold);
-            // Get happiness of the next cycle
-            happiness = getBoardHappiness(dimensions, board);
+            // Generate the next cycle and get its moves and happiness
+            gameStep(&game, dimensions, board, strengthThreshold, &stats);
+
+            converged = stopAtEquilibrium &&
+                        settled(&equilibrium, &game, stats.moves);
         }
 
+        freeViewport(&view);
         endwin();  // End curses mode at end of program
+
+        // The screen is back to normal by now, so infinite mode only writes
+        // the counters here
+        reportCounters(&game, cycle, instrumentEvery, 1);
     }
     // Otherwise print mode runs (-c flag was included)
     else {
 
-        // For loop runs specified number of times from -c flag
-        for (cycle = 0; cycle <= numCycles; cycle++) {
+        double stepSeconds = 0;  // Time spent in gameStep
+        int steps = 0;  // Number of times gameStep was timed
+
+        // Room for the text of one frame, reused for every frame printed
+        char *frame = malloc((size_t)dimensions * (dimensions + 1) +
+                             FRAME_INFO_SIZE);
+        if (frame == NULL) {
+            fprintf(stderr, "not enough memory to print a %dx%d board\n",
+                    dimensions, dimensions);
+            if (metricsPath != NULL) {
+                closeMetrics(&metrics);
+            }
+            freeGame(&game);
+            freeBoard(dimensions, board);
+            return EXIT_FAILURE;
+        }
+
+        // A resumed board that is already past the -c flag is just printed
+        int lastCycle = numCycles > startCycle ? numCycles : startCycle;
+
+        // For loop runs until the cycle from the -c flag, or until the board
+        // repeats if -q was given
+        for (cycle = startCycle; cycle <= lastCycle; cycle++) {
+
+            // Print the board and the info about it if it is one of the
+            // cycles asked for, always including the last one
+            if ((printEvery > 0 && cycle % printEvery == 0) ||
+                cycle == lastCycle || converged) {
+                printModePrint(frame, dimensions, board, cycle, &stats,
+                               strengthThreshold, vacant, typePercents,
+                               numTypes, radius, torus, policy, update);
+            }
+            if (metricsPath != NULL) {
+                pushMetrics(&metrics, cycle, &stats);
+            }
+
+            // Save the board every Nth cycle, and at the last one
+            if (checkpointPath != NULL &&
+                ((checkpointEvery > 0 && cycle > startCycle &&
+                  cycle % checkpointEvery == 0) ||
+                 cycle == lastCycle || converged)) {
+                writeCheckpoint(checkpointPath, dimensions, board,
+                                strengthThreshold, vacant, typePercents,
+                                numTypes, radius, torus, policy, update,
+                                cycle, stats.moves, &rng);
+            }
 
-            // Print the board and the info about it
-            printModePrint(dimensions, board, cycle, moves, happiness,
-                           strengthThreshold, vacant, endline);
+            // Nothing new can happen once the board repeats
+            if (converged) {
+                break;
+            }
             
-            // Generate the next cycle and store the number of moves made
-            moves = gameMove(dimensions, board, strengthThreshold);
-            // Get the happiness of the next cycle
-            happiness = getBoardHappiness(dimensions, board);
+            // Generate the next cycle and get its moves and happiness
+            double start = seconds();
+            gameStep(&game, dimensions, board, strengthThreshold, &stats);
+            stepSeconds += seconds() - start;
+            steps++;
+            reportCounters(&game, cycle + 1, instrumentEvery, 0);
+
+            converged = stopAtEquilibrium &&
+                        settled(&equilibrium, &game, stats.moves);
+        }
+
+        free(frame);
+        reportCounters(&game, converged ? cycle : lastCycle, instrumentEvery,
+                       1);
+
+        // Report the time to standard error so the output is unchanged,
+        // which shows the speedup when run again with more threads
+        if (timed) {
+            fprintf(stderr, "threads: %d, gameStep: %.6f s over %d cycles\n",
+                    game.threads, stepSeconds, steps);
         }
     }
 
+    if (metricsPath != NULL && !closeMetrics(&metrics)) {
+        fprintf(stderr, "could not write all of the metrics to %s\n",
+                metricsPath);
+    }
+
+    // Report where the board started repeating if -q stopped the run
+    if (converged) {
+        printf("equilibrium: cycle %d, period %d\n",
+               startCycle + equilibrium.convergedCycle, equilibrium.period);
+    }
+
+    freeGame(&game);
+    freeBoard(dimensions, board);
+
     // Return EXIT_SUCCESS if program runs successfully
     return EXIT_SUCCESS;
 }
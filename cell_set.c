@@ -0,0 +1,210 @@
+//
+// File: cell_set.c
+// Description: Contains the functions for the hierarchical cell bitmap. A bit
+// is set in a level above 0 exactly when the matching word of the level
+// below is non-zero, which lets searches skip empty stretches of the board
+// 64 words at a time.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include <stdlib.h>
+
+#include "cell_set.h"
+
+
+/**
+ * initCellSet(): Works out how many words each level needs, adding levels
+ * until one word covers everything, and allocates them all zeroed.
+ */
+int initCellSet(CellSet *set, size_t size) {
+
+    size_t bits = size > 0 ? size : 1;  // Bits needed in the current level
+
+    set->size = size;
+    set->levels = 0;
+
+    // Add levels until the top level fits in a single word
+    do {
+        size_t words = (bits + 63) / 64;
+
+        set->words[set->levels] = words;
+        set->level[set->levels] = calloc(words, sizeof(uint64_t));
+
+        // Give back what was allocated so far if memory ran out
+        if (set->level[set->levels] == NULL) {
+            freeCellSet(set);
+            return 0;
+        }
+
+        set->levels++;
+        bits = words;
+    } while (bits > 1 && set->levels < CELL_SET_MAX_LEVELS);
+
+    return 1;
+}
+
+
+/**
+ * freeCellSet(): Frees every level of the bitmap.
+ */
+void freeCellSet(CellSet *set) {
+
+    for (int k = 0; k < set->levels; k++) {
+        free(set->level[k]);
+        set->level[k] = NULL;
+    }
+    set->levels = 0;
+}
+
+
+/**
+ * clearCellSet(): Zeroes every level of the bitmap.
+ */
+void clearCellSet(CellSet *set) {
+
+    for (int k = 0; k < set->levels; k++) {
+        for (size_t w = 0; w < set->words[k]; w++) {
+            set->level[k][w] = 0;
+        }
+    }
+}
+
+
+/**
+ * cellSetInsert(): Sets the cell's bit, and keeps going up a level for as
+ * long as the word it landed in was empty before.
+ */
+void cellSetInsert(CellSet *set, size_t index) {
+
+    for (int k = 0; k < set->levels; k++) {
+        uint64_t *word = &set->level[k][index >> 6];
+        int wasEmpty = (*word == 0);
+
+        *word |= (uint64_t)1 << (index & 63);
+
+        // The level above already knows about this word
+        if (!wasEmpty) {
+            break;
+        }
+        index >>= 6;
+    }
+}
+
+
+/**
+ * cellSetRemove(): Clears the cell's bit, and keeps going up a level for as
+ * long as the word it was in became empty.
+ */
+void cellSetRemove(CellSet *set, size_t index) {
+
+    for (int k = 0; k < set->levels; k++) {
+        uint64_t *word = &set->level[k][index >> 6];
+
+        *word &= ~((uint64_t)1 << (index & 63));
+
+        // The word still has cells in it, so the level above stays set
+        if (*word != 0) {
+            break;
+        }
+        index >>= 6;
+    }
+}
+
+
+/**
+ * cellSetContains(): Checks the cell's bit in level 0.
+ */
+int cellSetContains(const CellSet *set, size_t index) {
+
+    return (set->level[0][index >> 6] >> (index & 63)) & 1;
+}
+
+
+/**
+ * cellSetFirst(): Starts at the single top word and follows the lowest set
+ * bit of each level down to level 0.
+ */
+long cellSetFirst(const CellSet *set) {
+
+    size_t pos = 0;  // Index of the word being looked at in each level
+
+    if (set->level[set->levels - 1][0] == 0) {
+        return -1;
+    }
+
+    for (int k = set->levels - 1; k >= 0; k--) {
+        pos = (pos << 6) | (size_t)__builtin_ctzll(set->level[k][pos]);
+    }
+
+    return (long)pos;
+}
+
+
+/**
+ * cellSetLast(): Starts at the single top word and follows the highest set
+ * bit of each level down to level 0.
+ */
+long cellSetLast(const CellSet *set) {
+
+    size_t pos = 0;  // Index of the word being looked at in each level
+
+    if (set->level[set->levels - 1][0] == 0) {
+        return -1;
+    }
+
+    for (int k = set->levels - 1; k >= 0; k--) {
+        pos = (pos << 6) | (size_t)(63 - __builtin_clzll(set->level[k][pos]));
+    }
+
+    return (long)pos;
+}
+
+
+/**
+ * cellSetNext(): Climbs the levels until a word has a set bit at or after
+ * the position being searched for, then follows the lowest set bits back
+ * down to level 0.
+ */
+long cellSetNext(const CellSet *set, size_t from) {
+
+    size_t pos = from;  // Position being searched for in the current level
+    int k;
+
+    if (from >= set->size) {
+        return -1;
+    }
+
+    // Climb until some word has a bit at or after pos
+    for (k = 0; k < set->levels; k++) {
+        size_t w = pos >> 6;
+
+        // Nothing is left in this level past pos
+        if (w >= set->words[k]) {
+            return -1;
+        }
+
+        uint64_t bits = set->level[k][w] & (~(uint64_t)0 << (pos & 63));
+        if (bits) {
+            pos = (w << 6) | (size_t)__builtin_ctzll(bits);
+            break;
+        }
+
+        // Look past this word in the level above
+        pos = w + 1;
+    }
+
+    if (k == set->levels) {
+        return -1;
+    }
+
+    // Descend to level 0 following the lowest set bits
+    while (k > 0) {
+        k--;
+        pos = (pos << 6) | (size_t)__builtin_ctzll(set->level[k][pos]);
+    }
+
+    return (long)pos;
+}
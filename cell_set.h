@@ -0,0 +1,123 @@
+//
+// File: cell_set.h
+// Description: Provides a hierarchical bitmap over the cells of the board.
+// Level 0 has one bit per cell, and every level above it has one bit per
+// non-zero word of the level below. Finding the lowest or highest cell in the
+// set, or the next cell after a given one, only touches one word per level
+// using find-first-set and find-last-set operations, so it costs a handful
+// of instructions no matter how large the board is.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for cell_set.h
+#ifndef _CELL_SET_H_
+#define _CELL_SET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Enough levels for 64^8 cells, far more than the largest board allowed
+#define CELL_SET_MAX_LEVELS 8
+
+
+/**
+ * CellSet is a set of cell indices in [0, size), where a cell's index is
+ * row * dimensions + col.
+ */
+typedef struct {
+    size_t size;                              // number of cells covered
+    int levels;                               // number of bitmap levels
+    size_t words[CELL_SET_MAX_LEVELS];        // words in each level
+    uint64_t *level[CELL_SET_MAX_LEVELS];     // the bitmap of each level
+} CellSet;
+
+
+/**
+ * initCellSet allocates an empty set able to hold the cells [0, size).
+ *
+ * @param set   the set to initialize
+ * @param size  the number of cells the set covers
+ * @returns     1 if the set was allocated, 0 if memory ran out
+ */
+int initCellSet(CellSet *set, size_t size);
+
+
+/**
+ * freeCellSet releases the memory held by a set.
+ *
+ * @param set  the set to free
+ */
+void freeCellSet(CellSet *set);
+
+
+/**
+ * clearCellSet removes every cell from a set.
+ *
+ * @param set  the set to clear
+ */
+void clearCellSet(CellSet *set);
+
+
+/**
+ * cellSetInsert adds a cell to a set.
+ *
+ * @param set    the set to add to
+ * @param index  the index of the cell to add
+ */
+void cellSetInsert(CellSet *set, size_t index);
+
+
+/**
+ * cellSetRemove removes a cell from a set.
+ *
+ * @param set    the set to remove from
+ * @param index  the index of the cell to remove
+ */
+void cellSetRemove(CellSet *set, size_t index);
+
+
+/**
+ * cellSetContains checks whether a cell is in a set.
+ *
+ * @param set    the set to check
+ * @param index  the index of the cell to look for
+ * @returns      1 if the cell is in the set, 0 otherwise
+ */
+int cellSetContains(const CellSet *set, size_t index);
+
+
+/**
+ * cellSetFirst finds the lowest cell in a set.
+ *
+ * @param set  the set to search
+ * @returns    the lowest index in the set, or -1 if the set is empty
+ */
+long cellSetFirst(const CellSet *set);
+
+
+/**
+ * cellSetLast finds the highest cell in a set.
+ *
+ * @param set  the set to search
+ * @returns    the highest index in the set, or -1 if the set is empty
+ */
+long cellSetLast(const CellSet *set);
+
+
+/**
+ * cellSetNext finds the lowest cell in a set that is at or after a given
+ * index, which allows walking the set in raster order.
+ *
+ * @param set   the set to search
+ * @param from  the index to start searching from
+ * @returns     the lowest index in the set that is >= from, or -1 if there
+ *              is none
+ */
+long cellSetNext(const CellSet *set, size_t from);
+
+
+// End include guard
+#endif
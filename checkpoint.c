@@ -0,0 +1,210 @@
+//
+// File: checkpoint.c
+// Description: Contains the functions that pack a board into a checkpoint
+// file, and map one back in and unpack its board.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * writePlane(): Packs the board one row at a time into the bits of the given
+ * type, or of every agent for a type of -1, and writes each row out,
+ * returning 1 if every row was written.
+ */
+static int writePlane(FILE *file, int dimensions,
+                      char board[dimensions][dimensions], uint64_t *row,
+                      size_t wordsPerRow, int type) {
+
+    for (int i = 0; i < dimensions; i++) {
+        memset(row, 0, wordsPerRow * sizeof(uint64_t));
+
+        for (int j = 0; j < dimensions; j++) {
+            int agentType = AGENT_TYPE(board[i][j]);
+
+            if (type < 0 ? agentType >= 0 : agentType == type) {
+                row[j / 64] |= (uint64_t)1 << (j % 64);
+            }
+        }
+
+        if (fwrite(row, sizeof(uint64_t), wordsPerRow, file) != wordsPerRow) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * saveCheckpoint(): Writes the header and every plane to path with ".tmp"
+ * added, flushes it to disk, and renames it over path so the old checkpoint
+ * is only replaced once the new one is complete.
+ */
+int saveCheckpoint(const char *path, CheckpointHeader *header,
+                   int dimensions, char board[dimensions][dimensions]) {
+
+    size_t wordsPerRow = ((size_t)dimensions + 63) / 64;
+    char *tempPath = malloc(strlen(path) + sizeof(".tmp"));
+    uint64_t *row = malloc(wordsPerRow * sizeof(uint64_t));
+    FILE *file = NULL;
+    int saved = 0;  // Boolean, true once the checkpoint is in place
+
+    memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+    header->version = CHECKPOINT_VERSION;
+    header->dimensions = dimensions;
+
+    if (tempPath != NULL && row != NULL) {
+        strcpy(tempPath, path);
+        strcat(tempPath, ".tmp");
+        file = fopen(tempPath, "wb");
+    }
+
+    if (file != NULL) {
+        int written = fwrite(header, sizeof(*header), 1, file) == 1;
+
+        // The occupied plane, then the plane of each type but the last
+        for (int type = -1; type < header->numTypes - 1 && written; type++) {
+            written = writePlane(file, dimensions, board, row, wordsPerRow,
+                                 type);
+        }
+        written = written && fflush(file) == 0 && fsync(fileno(file)) == 0;
+
+        // Only rename a file that was completely written and closed
+        if (fclose(file) == 0 && written &&
+            rename(tempPath, path) == 0) {
+            saved = 1;
+        }
+        else {
+            remove(tempPath);
+        }
+    }
+
+    free(tempPath);
+    free(row);
+
+    return saved;
+}
+
+
+/**
+ * openCheckpoint(): Maps the whole file read-only, then checks the magic,
+ * version, dimensions, and number of types, and that the file is exactly
+ * as long as the header and every plane of a board that size.
+ */
+int openCheckpoint(Checkpoint *checkpoint, const char *path) {
+
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+
+    checkpoint->map = NULL;
+
+    if (fd < 0) {
+        return 0;
+    }
+
+    if (fstat(fd, &info) != 0 ||
+        (size_t)info.st_size < sizeof(CheckpointHeader)) {
+        close(fd);
+        return 0;
+    }
+
+    checkpoint->size = info.st_size;
+    void *map = mmap(NULL, checkpoint->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping stays valid after the file is closed
+
+    if (map == MAP_FAILED) {
+        return 0;
+    }
+
+    const CheckpointHeader *header = map;
+    size_t planeWords = 0;
+
+    if (header->dimensions > 0) {
+        planeWords = ((size_t)header->dimensions + 63) / 64 *
+                     header->dimensions;
+    }
+
+    if (memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != CHECKPOINT_VERSION || planeWords == 0 ||
+        header->numTypes < 2 || header->numTypes > MAX_TYPES ||
+        checkpoint->size != sizeof(*header) + header->numTypes *
+                            planeWords * sizeof(uint64_t)) {
+        munmap(map, checkpoint->size);
+        return 0;
+    }
+
+#ifdef MADV_SEQUENTIAL
+    madvise(map, checkpoint->size, MADV_SEQUENTIAL);  // Only a hint
+#endif
+
+    checkpoint->map = map;
+    checkpoint->header = header;
+    checkpoint->occupied = (const uint64_t *)(header + 1);
+    checkpoint->types = checkpoint->occupied + planeWords;
+
+    return 1;
+}
+
+
+/**
+ * loadCheckpoint(): Turns the bits of each cell back into a char, giving an
+ * occupied cell the type of the first plane it is in, or the last type if
+ * it is in none of them.
+ */
+void loadCheckpoint(const Checkpoint *checkpoint, int dimensions,
+                    char board[dimensions][dimensions]) {
+
+    size_t wordsPerRow = ((size_t)dimensions + 63) / 64;
+    size_t planeWords = wordsPerRow * dimensions;
+    int numTypes = checkpoint->header->numTypes;
+
+    for (int i = 0; i < dimensions; i++) {
+        const uint64_t *occupied = checkpoint->occupied + i * wordsPerRow;
+        const uint64_t *types = checkpoint->types + i * wordsPerRow;
+
+        for (int j = 0; j < dimensions; j++) {
+            uint64_t bit = (uint64_t)1 << (j % 64);
+            int type = numTypes - 1;
+
+            if (!(occupied[j / 64] & bit)) {
+                board[i][j] = '.';
+                continue;
+            }
+
+            for (int k = 0; k < numTypes - 1; k++) {
+                if (types[k * planeWords + j / 64] & bit) {
+                    type = k;
+                    break;
+                }
+            }
+
+            board[i][j] = AGENT_CHARS[type];
+        }
+    }
+}
+
+
+/**
+ * closeCheckpoint(): Unmaps the file.
+ */
+void closeCheckpoint(Checkpoint *checkpoint) {
+
+    if (checkpoint->map != NULL) {
+        munmap(checkpoint->map, checkpoint->size);
+    }
+
+    checkpoint->map = NULL;
+}
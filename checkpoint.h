@@ -0,0 +1,121 @@
+//
+// File: checkpoint.h
+// Description: Provides a binary snapshot of a board that a later run can
+// pick up from. A checkpoint is a fixed header followed by the board packed
+// into the bitplanes of packed_board.h, one with a bit set for every
+// non-vacant cell and one for each type of agent but the last, so a board of
+// two types takes a quarter of its size in memory. Checkpoints are written to a
+// temporary file that is renamed over the old one, so a run that is stopped
+// part way through never leaves a broken checkpoint behind. They are read
+// back by mapping the file, so the planes are unpacked straight from the
+// page cache without reading the file into a buffer first.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for checkpoint.h
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "agent_types.h"
+
+// First 8 bytes of every checkpoint
+#define CHECKPOINT_MAGIC "BRACETPA"
+
+// Changes whenever the layout of a checkpoint does
+#define CHECKPOINT_VERSION 6
+
+
+/**
+ * CheckpointHeader is the start of a checkpoint file. Every field has a
+ * fixed size, and the planes start right after it on an 8 byte boundary.
+ */
+typedef struct {
+    char magic[8];               // CHECKPOINT_MAGIC, not null terminated
+    uint32_t version;            // CHECKPOINT_VERSION
+    int32_t dimensions;          // the size of the square board
+    int32_t strengthThreshold;   // happiness needed to stay in place
+    int32_t vacancy;             // percentage of the board that is vacant
+    int32_t numTypes;            // types of agents in the board
+    int32_t typePercents[MAX_TYPES];  // percentage of agents of each type
+    int32_t cycle;               // the cycle the board is on
+    int32_t radius;              // neighborhood radius the board was run with
+    int32_t torus;               // 1 if the board wraps around, 0 if not
+    int32_t policy;              // MovePolicy agents pick vacancies with
+    int32_t update;              // UpdateMode the agents move with
+    int64_t moves;               // moves made during that cycle
+    uint64_t rngState[4];        // state of the random number generator
+} CheckpointHeader;
+
+
+/**
+ * Checkpoint is a checkpoint file mapped into memory.
+ */
+typedef struct {
+    const CheckpointHeader *header;  // the header at the start of the file
+    const uint64_t *occupied;        // bit set for every non-vacant cell
+    const uint64_t *types;           // plane of each type but the last
+    void *map;                       // the whole file
+    size_t size;                     // bytes in the file
+} Checkpoint;
+
+
+/**
+ * saveCheckpoint writes a board and its header to a temporary file next to
+ * path, then renames it to path.
+ *
+ * @param path        the file to write
+ * @param header      the header to write, with magic, version, and
+ *                    dimensions left for this to fill in, and numTypes set
+ *                    to the types in the board
+ * @param dimensions  the size of the square 2D array given
+ * @param board       a 2D array of chars
+ * @returns           1 if the checkpoint was written, 0 otherwise, in which
+ *                    case any checkpoint already at path is left alone
+ */
+int saveCheckpoint(const char *path, CheckpointHeader *header,
+                   int dimensions, char board[dimensions][dimensions]);
+
+
+/**
+ * openCheckpoint maps a checkpoint file and checks that its header and size
+ * are valid.
+ *
+ * @param checkpoint  the mapped checkpoint to set up
+ * @param path        the file to map
+ * @returns           1 if the file is a valid checkpoint, 0 otherwise
+ */
+int openCheckpoint(Checkpoint *checkpoint, const char *path);
+
+
+/**
+ * loadCheckpoint unpacks the board of a mapped checkpoint.
+ *
+ * @param checkpoint  the checkpoint to unpack
+ * @param dimensions  the size of the square 2D array given, which must be
+ *                    the dimensions in the checkpoint's header
+ * @param board       a 2D array of chars filled with the checkpoint's board
+ */
+void loadCheckpoint(const Checkpoint *checkpoint, int dimensions,
+                    char board[dimensions][dimensions]);
+
+
+/**
+ * closeCheckpoint unmaps a checkpoint file.
+ *
+ * @param checkpoint  the checkpoint to close
+ */
+void closeCheckpoint(Checkpoint *checkpoint);
+
+
+// End include guard
+#endif
@@ -0,0 +1,63 @@
+//
+// File: counters.c
+// Description: Contains the functions that reset, time, and print the
+// counters of a game.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "counters.h"
+
+#include <string.h>
+#include <time.h>
+
+
+/**
+ * initCounters(): Clears everything, then sets whether to count.
+ */
+void initCounters(Counters *counters, int enabled) {
+
+    memset(counters, 0, sizeof(*counters));
+    counters->enabled = enabled;
+}
+
+
+/**
+ * countersClock(): Reads CLOCK_MONOTONIC, which never jumps when the system
+ * time is changed.
+ */
+double countersClock(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/**
+ * printCounters(): Writes the counts, then the time of each phase by name.
+ */
+void printCounters(const Counters *counters, int cycle, FILE *out) {
+
+    static const char *phaseNames[NUM_PHASES] = {
+        "check", "move", "update", "stats", "board_happiness"
+    };
+
+    fprintf(out, "{\"cycle\": %d, \"cycles\": %llu, "
+            "\"happiness_checks\": %llu, \"vacancy_lookups\": %llu, "
+            "\"moves\": %llu, \"failed_moves\": %llu, \"phase_seconds\": {",
+            cycle, (unsigned long long)counters->cycles,
+            (unsigned long long)counters->happinessChecks,
+            (unsigned long long)counters->vacancyLookups,
+            (unsigned long long)counters->moves,
+            (unsigned long long)counters->failedMoves);
+
+    for (int p = 0; p < NUM_PHASES; p++) {
+        fprintf(out, "%s\"%s\": %.6f", p > 0 ? ", " : "", phaseNames[p],
+                counters->phaseSeconds[p]);
+    }
+    fprintf(out, "}}\n");
+}
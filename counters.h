@@ -0,0 +1,123 @@
+//
+// File: counters.h
+// Description: Provides counters and phase timers for the work gameMove does,
+// so a run can show where its time goes without an outside profiler. They
+// are turned on for a run with --instrument, and can be left out of the
+// build completely by compiling with -DCOUNTERS=0, in which case every hook
+// in the game turns into nothing.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for counters.h
+#ifndef _COUNTERS_H_
+#define _COUNTERS_H_
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+// Set to 0 to build without the counters
+#ifndef COUNTERS
+#define COUNTERS 1
+#endif
+
+
+/**
+ * Phase is a part of a cycle that gets its own timer. PHASE_CHECK finds the
+ * unhappy agents, PHASE_MOVE moves them, PHASE_UPDATE brings the neighbor
+ * counts or the copy of the board the kernel reads up to date, PHASE_STATS
+ * adds up the statistics of the new board, and PHASE_BOARD_HAPPINESS is
+ * getBoardHappiness.
+ */
+typedef enum {
+    PHASE_CHECK,
+    PHASE_MOVE,
+    PHASE_UPDATE,
+    PHASE_STATS,
+    PHASE_BOARD_HAPPINESS,
+    NUM_PHASES
+} Phase;
+
+
+/**
+ * Counters holds what has been counted and timed since the game started.
+ * The counts are added a whole pass or move at a time rather than a cell at
+ * a time, so they cost next to nothing even while they are on.
+ */
+typedef struct {
+    int enabled;                      // boolean, true if anything is counted
+    uint64_t cycles;                  // calls to gameMove
+    uint64_t happinessChecks;         // agents whose happiness was found
+    uint64_t vacancyLookups;          // vacant spots looked up by moveAgent
+    uint64_t moves;                   // agents that moved
+    uint64_t failedMoves;             // moves with no vacant spot left
+    double phaseSeconds[NUM_PHASES];  // time spent in each phase
+} Counters;
+
+
+#if COUNTERS
+
+// Adds n to one of the counts if the counters are on
+#define COUNT(counters, field, n) \
+    do { \
+        if ((counters)->enabled) { \
+            (counters)->field += (n); \
+        } \
+    } while (0)
+
+// Gives the start time of a phase, or 0 if the counters are off
+#define PHASE_START(counters) ((counters)->enabled ? countersClock() : 0.0)
+
+// Adds the time since start to a phase if the counters are on
+#define PHASE_END(counters, phase, start) \
+    do { \
+        if ((counters)->enabled) { \
+            (counters)->phaseSeconds[phase] += countersClock() - (start); \
+        } \
+    } while (0)
+
+#else
+
+#define COUNT(counters, field, n) ((void)(n))
+#define PHASE_START(counters) 0.0
+#define PHASE_END(counters, phase, start) ((void)(start))
+
+#endif
+
+
+/**
+ * initCounters zeroes every count and timer.
+ *
+ * @param counters  the counters to initialize
+ * @param enabled   1 to count from now on, 0 to leave them off
+ */
+void initCounters(Counters *counters, int enabled);
+
+
+/**
+ * countersClock reads the monotonic clock the phases are timed with.
+ *
+ * @returns  the current time of the monotonic clock in seconds
+ */
+double countersClock(void);
+
+
+/**
+ * printCounters writes the counts and phase times as a single line of JSON.
+ *
+ * @param counters  the counters to print
+ * @param cycle     the cycle the board is on
+ * @param out       the stream to write to
+ */
+void printCounters(const Counters *counters, int cycle, FILE *out);
+
+
+// End include guard
+#endif
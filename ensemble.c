@@ -0,0 +1,374 @@
+//
+// File: ensemble.c
+// Description: Contains the functions for the bit-sliced ensemble. A row is
+// counted by padding the three rows around it with the cells just off each
+// edge, then adding the eight shifted rows into four counter words per
+// cell, the same way the packed kernel counts 64 cells of one board. The
+// counts are turned into an unhappy bit for every replica by comparing them
+// against a table made from the threshold.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "ensemble.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "agent_types.h"
+#include "play_game.h"
+
+
+/**
+ * initEnsemble(): Allocates the planes, the scratch rows, and the sets of
+ * every replica.
+ */
+int initEnsemble(Ensemble *ensemble, int dimensions, int torus,
+                 int numReplicas) {
+
+    size_t totalSpaces = (size_t)dimensions * dimensions;
+
+    ensemble->dimensions = dimensions;
+    ensemble->torus = torus;
+    ensemble->numReplicas = numReplicas;
+    ensemble->endline = calloc(totalSpaces, sizeof(uint64_t));
+    ensemble->newline = calloc(totalSpaces, sizeof(uint64_t));
+    ensemble->scratch = malloc((6 * ((size_t)dimensions + 2) +
+                                8 * (size_t)dimensions) * sizeof(uint64_t));
+    ensemble->moveFrom = malloc(totalSpaces * sizeof(size_t));
+
+    for (int r = 0; r < ENSEMBLE_MAX_REPLICAS; r++) {
+        ensemble->unhappy[r].levels = 0;
+        ensemble->vacancies[r].levels = 0;
+        ensemble->hash[r] = 0;
+    }
+
+    if (ensemble->endline == NULL || ensemble->newline == NULL ||
+        ensemble->scratch == NULL || ensemble->moveFrom == NULL) {
+        freeEnsemble(ensemble);
+        return 0;
+    }
+
+    for (int r = 0; r < numReplicas; r++) {
+        if (!initCellSet(&ensemble->unhappy[r], totalSpaces) ||
+            !initCellSet(&ensemble->vacancies[r], totalSpaces)) {
+            freeEnsemble(ensemble);
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * freeEnsemble(): Frees the planes, the scratch rows, and the sets.
+ */
+void freeEnsemble(Ensemble *ensemble) {
+
+    free(ensemble->endline);
+    free(ensemble->newline);
+    free(ensemble->scratch);
+    free(ensemble->moveFrom);
+
+    for (int r = 0; r < ENSEMBLE_MAX_REPLICAS; r++) {
+        freeCellSet(&ensemble->unhappy[r]);
+        freeCellSet(&ensemble->vacancies[r]);
+    }
+
+    ensemble->endline = NULL;
+    ensemble->newline = NULL;
+    ensemble->scratch = NULL;
+    ensemble->moveFrom = NULL;
+}
+
+
+/**
+ * ensembleSetBoard(): Sets the replica's bit of every cell from the board,
+ * and finds its vacancies and hash along the way.
+ */
+void ensembleSetBoard(Ensemble *ensemble, int replica, int dimensions,
+                      char board[dimensions][dimensions]) {
+
+    uint64_t bit = (uint64_t)1 << replica;
+    CellSet *vacancies = &ensemble->vacancies[replica];
+
+    clearCellSet(vacancies);
+    ensemble->hash[replica] = 0;
+
+    for (int i = 0; i < dimensions; i++) {
+        for (int j = 0; j < dimensions; j++) {
+            size_t cell = (size_t)i * dimensions + j;
+            int type = AGENT_TYPE(board[i][j]);
+
+            ensemble->endline[cell] &= ~bit;
+            ensemble->newline[cell] &= ~bit;
+
+            if (type == 0) {
+                ensemble->endline[cell] |= bit;
+            }
+            else if (type == 1) {
+                ensemble->newline[cell] |= bit;
+            }
+
+            if (type < 0) {
+                cellSetInsert(vacancies, cell);
+            }
+            else {
+                ensemble->hash[replica] ^= agentHash(cell, board[i][j]);
+            }
+        }
+    }
+}
+
+
+/**
+ * ensembleGetBoard(): Reads the replica's bit of every cell back into a
+ * char.
+ */
+void ensembleGetBoard(const Ensemble *ensemble, int replica, int dimensions,
+                      char board[dimensions][dimensions]) {
+
+    for (int i = 0; i < dimensions; i++) {
+        for (int j = 0; j < dimensions; j++) {
+            size_t cell = (size_t)i * dimensions + j;
+
+            if ((ensemble->endline[cell] >> replica) & 1) {
+                board[i][j] = AGENT_CHARS[0];
+            }
+            else if ((ensemble->newline[cell] >> replica) & 1) {
+                board[i][j] = AGENT_CHARS[1];
+            }
+            else {
+                board[i][j] = '.';
+            }
+        }
+    }
+}
+
+
+/**
+ * padRow(): Copies a row of a plane with one cell past each end, wrapping
+ * around for a torus. A row off the edge of a bounded board, and the cells
+ * past its ends, are empty.
+ */
+static void padRow(const Ensemble *ensemble, const uint64_t *plane, int row,
+                   uint64_t *padded) {
+
+    int dimensions = ensemble->dimensions;
+
+    if (row < 0 || row >= dimensions) {
+        if (!ensemble->torus) {
+            memset(padded, 0, (dimensions + 2) * sizeof(uint64_t));
+            return;
+        }
+        row = row < 0 ? dimensions - 1 : 0;
+    }
+
+    const uint64_t *cells = plane + (size_t)row * dimensions;
+
+    memcpy(padded + 1, cells, dimensions * sizeof(uint64_t));
+    padded[0] = ensemble->torus ? cells[dimensions - 1] : 0;
+    padded[dimensions + 1] = ensemble->torus ? cells[0] : 0;
+}
+
+
+/**
+ * addRow(): Adds a one-bit value to the four bit-sliced counters of every
+ * cell in a row, rippling the carry up through the counter bits.
+ */
+static void addRow(uint64_t *counters, const uint64_t *bits, int dimensions) {
+
+    uint64_t *c0 = counters;
+    uint64_t *c1 = counters + dimensions;
+    uint64_t *c2 = counters + 2 * dimensions;
+    uint64_t *c3 = counters + 3 * dimensions;
+
+    for (int j = 0; j < dimensions; j++) {
+        uint64_t x = bits[j];
+        uint64_t carry;
+
+        carry = c0[j] & x;
+        c0[j] ^= x;
+        x = carry;
+        carry = c1[j] & x;
+        c1[j] ^= x;
+        x = carry;
+        carry = c2[j] & x;
+        c2[j] ^= x;
+        c3[j] |= carry;  // At most 8 neighbors, so bit 3 never carries
+    }
+}
+
+
+/**
+ * equalMask(): Gives the replicas whose four-bit counter equals value.
+ */
+static uint64_t equalMask(const uint64_t count[4], int value) {
+
+    uint64_t mask = ~(uint64_t)0;
+
+    for (int b = 0; b < 4; b++) {
+        mask &= (value >> b) & 1 ? count[b] : ~count[b];
+    }
+
+    return mask;
+}
+
+
+/**
+ * findUnhappy(): Counts the endline and newline neighbors of every cell of
+ * every replica a row at a time, then marks the agents whose same-type count
+ * is below the happy minimum for their total.
+ */
+static void findUnhappy(Ensemble *ensemble, const int happyMinimum[9],
+                        uint64_t active) {
+
+    int dimensions = ensemble->dimensions;
+    size_t padWidth = (size_t)dimensions + 2;
+    uint64_t *endlinePad = ensemble->scratch;  // Rows above, at, and below
+    uint64_t *newlinePad = endlinePad + 3 * padWidth;
+    uint64_t *endlineCount = newlinePad + 3 * padWidth;  // 4 words per cell
+    uint64_t *newlineCount = endlineCount + 4 * dimensions;
+
+    for (int i = 0; i < dimensions; i++) {
+        for (int di = 0; di < 3; di++) {
+            padRow(ensemble, ensemble->endline, i + di - 1,
+                   endlinePad + di * padWidth);
+            padRow(ensemble, ensemble->newline, i + di - 1,
+                   newlinePad + di * padWidth);
+        }
+
+        memset(endlineCount, 0, 8 * dimensions * sizeof(uint64_t));
+
+        // Each of the eight neighbors is the padded row shifted by dj
+        for (int di = 0; di < 3; di++) {
+            for (int dj = 0; dj < 3; dj++) {
+                if (di == 1 && dj == 1) {
+                    continue;
+                }
+                addRow(endlineCount, endlinePad + di * padWidth + dj,
+                       dimensions);
+                addRow(newlineCount, newlinePad + di * padWidth + dj,
+                       dimensions);
+            }
+        }
+
+        for (int j = 0; j < dimensions; j++) {
+            size_t cell = (size_t)i * dimensions + j;
+            uint64_t isEndline = ensemble->endline[cell];
+            uint64_t occupied = isEndline | ensemble->newline[cell];
+            uint64_t total[4];
+            uint64_t same[4];
+            uint64_t carry = 0;
+
+            // Add the two counts for the total, and pick the one of the
+            // agent's own type for the same count
+            for (int b = 0; b < 4; b++) {
+                uint64_t e = endlineCount[b * dimensions + j];
+                uint64_t n = newlineCount[b * dimensions + j];
+
+                total[b] = e ^ n ^ carry;
+                carry = (e & n) | (carry & (e ^ n));
+                same[b] = (e & isEndline) | (n & ~isEndline);
+            }
+
+            // below[k] is the replicas with fewer than k same neighbors
+            uint64_t below[10];
+            below[0] = 0;
+            for (int k = 0; k < 9; k++) {
+                below[k + 1] = below[k] | equalMask(same, k);
+            }
+
+            uint64_t unhappy = 0;
+            for (int t = 0; t <= 8; t++) {
+                unhappy |= equalMask(total, t) & below[happyMinimum[t]];
+            }
+
+            for (uint64_t bits = unhappy & occupied & active; bits != 0;
+                 bits &= bits - 1) {
+                cellSetInsert(&ensemble->unhappy[__builtin_ctzll(bits)],
+                              cell);
+            }
+        }
+    }
+}
+
+
+/**
+ * moveReplica(): Moves the unhappy agents of one replica in row order to the
+ * last, then first, then last vacant spot and so on, until no spot is left.
+ * The spots they leave can only be moved into from the next cycle on.
+ */
+static long moveReplica(Ensemble *ensemble, int replica) {
+
+    uint64_t bit = (uint64_t)1 << replica;
+    CellSet *unhappy = &ensemble->unhappy[replica];
+    CellSet *vacancies = &ensemble->vacancies[replica];
+    int first = 0;
+    long numMoves = 0;
+
+    for (long cell = cellSetFirst(unhappy); cell >= 0;
+         cell = cellSetNext(unhappy, cell + 1)) {
+        long spot = first ? cellSetFirst(vacancies) : cellSetLast(vacancies);
+
+        if (spot < 0) {
+            break;
+        }
+
+        int isEndline = (ensemble->endline[cell] & bit) != 0;
+        uint64_t *plane = isEndline ? ensemble->endline : ensemble->newline;
+        char agent = AGENT_CHARS[isEndline ? 0 : 1];
+
+        plane[cell] &= ~bit;
+        plane[spot] |= bit;
+        cellSetRemove(vacancies, spot);
+        ensemble->hash[replica] ^= agentHash(cell, agent) ^
+                                   agentHash(spot, agent);
+
+        ensemble->moveFrom[numMoves++] = cell;
+        first = !first;
+    }
+
+    for (long m = 0; m < numMoves; m++) {
+        cellSetInsert(vacancies, ensemble->moveFrom[m]);
+    }
+
+    return numMoves;
+}
+
+
+/**
+ * ensembleStep(): Finds the unhappy agents of every active replica at once,
+ * then moves each replica's agents on its own. The fewest same-type
+ * neighbors an agent with a given total needs is worked out once with
+ * happinessFromCounts, so the replicas agree exactly with a single board.
+ */
+void ensembleStep(Ensemble *ensemble, int strengthThreshold, uint64_t active,
+                  long moves[]) {
+
+    int happyMinimum[9];
+
+    for (int total = 0; total <= 8; total++) {
+        int same = 0;
+
+        while (same <= total &&
+               (int)happinessFromCounts(same, total) < strengthThreshold) {
+            same++;
+        }
+        happyMinimum[total] = same;
+    }
+
+    for (uint64_t bits = active; bits != 0; bits &= bits - 1) {
+        clearCellSet(&ensemble->unhappy[__builtin_ctzll(bits)]);
+    }
+
+    findUnhappy(ensemble, happyMinimum, active);
+
+    for (uint64_t bits = active; bits != 0; bits &= bits - 1) {
+        int replica = __builtin_ctzll(bits);
+        moves[replica] = moveReplica(ensemble, replica);
+    }
+}
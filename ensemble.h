@@ -0,0 +1,119 @@
+//
+// File: ensemble.h
+// Description: Provides an ensemble of up to 64 replicas of a board, all the
+// same size, advanced a cycle at a time in lockstep. The boards are
+// bit-sliced: every cell has one word for endline agents and one for newline
+// agents, and bit r of each word is the cell in replica r. Counting the
+// neighbors and testing the happiness threshold is then a handful of
+// bitwise operations per cell for all of the replicas at once. Only the
+// moves are made one replica at a time, each with its own vacancies and its
+// own first and last alternation, so every replica plays exactly the game a
+// single board would.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for ensemble.h
+#ifndef _ENSEMBLE_H_
+#define _ENSEMBLE_H_
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cell_set.h"
+
+
+// Replicas in an ensemble, one per bit of a word
+#define ENSEMBLE_MAX_REPLICAS 64
+
+
+/**
+ * Ensemble holds the bit-sliced boards of the replicas and what each one
+ * keeps between cycles. Cell indices are row * dimensions + col as in a
+ * single board.
+ */
+typedef struct {
+    int dimensions;         // the size of the square board of every replica
+    int torus;              // boolean, true if the boards wrap around
+    int numReplicas;        // replicas there is room for
+    uint64_t *endline;      // a word per cell, bit r set for an endline agent
+    uint64_t *newline;      // a word per cell, bit r set for a newline agent
+    uint64_t *scratch;      // padded rows and counters for the row counted
+    size_t *moveFrom;       // cells left by the replica being moved
+    CellSet unhappy[ENSEMBLE_MAX_REPLICAS];    // agents that move this cycle
+    CellSet vacancies[ENSEMBLE_MAX_REPLICAS];  // cells vacant in both boards
+    uint64_t hash[ENSEMBLE_MAX_REPLICAS];      // hash of each replica's board
+} Ensemble;
+
+
+/**
+ * initEnsemble allocates an ensemble of empty boards.
+ *
+ * @param ensemble     the ensemble to initialize
+ * @param dimensions   the size of the square board of every replica
+ * @param torus        1 if the boards wrap around, 0 if they stop at the
+ *                     edges
+ * @param numReplicas  the number of replicas, from 1 to
+ *                     ENSEMBLE_MAX_REPLICAS
+ * @returns            1 if the ensemble was set up, 0 if memory ran out
+ */
+int initEnsemble(Ensemble *ensemble, int dimensions, int torus,
+                 int numReplicas);
+
+
+/**
+ * freeEnsemble releases the memory held by an ensemble.
+ *
+ * @param ensemble  the ensemble to free
+ */
+void freeEnsemble(Ensemble *ensemble);
+
+
+/**
+ * ensembleSetBoard copies a board of endline and newline agents into one of
+ * the replicas, replacing what it held.
+ *
+ * @param ensemble    the ensemble to copy into
+ * @param replica     the replica to set
+ * @param dimensions  the size of the square 2D array given
+ * @param board       a 2D array of chars
+ */
+void ensembleSetBoard(Ensemble *ensemble, int replica, int dimensions,
+                      char board[dimensions][dimensions]);
+
+
+/**
+ * ensembleGetBoard copies one of the replicas back out into a board.
+ *
+ * @param ensemble    the ensemble to copy from
+ * @param replica     the replica to get
+ * @param dimensions  the size of the square 2D array given
+ * @param board       filled with the chars of the replica
+ */
+void ensembleGetBoard(const Ensemble *ensemble, int replica, int dimensions,
+                      char board[dimensions][dimensions]);
+
+
+/**
+ * ensembleStep moves the unhappy agents of the active replicas just as
+ * gameMove would, and leaves the others as they are.
+ *
+ * @param ensemble           the ensemble to advance
+ * @param strengthThreshold  the happiness value an agent must be greater
+ *                           than or equal to to stay in place
+ * @param active             bit r set if replica r is advanced
+ * @param moves              filled with the moves made in each active
+ *                           replica
+ */
+void ensembleStep(Ensemble *ensemble, int strengthThreshold, uint64_t active,
+                  long moves[]);
+
+
+// End include guard
+#endif
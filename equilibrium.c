@@ -0,0 +1,51 @@
+//
+// File: equilibrium.c
+// Description: Contains the functions that keep the hashes of recent boards
+// in a ring, and look back through them for the board of the newest cycle.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "equilibrium.h"
+
+
+/**
+ * initEquilibrium(): Stores the hash of cycle 0 with nothing found yet.
+ */
+void initEquilibrium(Equilibrium *equilibrium, uint64_t hash) {
+
+    equilibrium->hashes[0] = hash;
+    equilibrium->cycle = 0;
+    equilibrium->convergedCycle = 0;
+    equilibrium->period = 0;
+}
+
+
+/**
+ * checkEquilibrium(): Looks back one cycle at a time so the shortest period
+ * is found first, then stores the new hash over the oldest one.
+ */
+int checkEquilibrium(Equilibrium *equilibrium, uint64_t hash) {
+
+    int cycle = ++equilibrium->cycle;
+
+    // Only as many cycles as are stored can be looked back on
+    int lookBack = cycle < EQUILIBRIUM_HISTORY ? cycle : EQUILIBRIUM_HISTORY;
+
+    equilibrium->period = 0;
+
+    for (int period = 1; period <= lookBack; period++) {
+        if (equilibrium->hashes[(cycle - period) % EQUILIBRIUM_HISTORY] ==
+            hash) {
+            equilibrium->convergedCycle = cycle - period;
+            equilibrium->period = period;
+            break;
+        }
+    }
+
+    equilibrium->hashes[cycle % EQUILIBRIUM_HISTORY] = hash;
+
+    return equilibrium->period > 0;
+}
@@ -0,0 +1,60 @@
+//
+// File: equilibrium.h
+// Description: Provides a way to tell when the board has stopped changing or
+// has started repeating itself. The next board only depends on the current
+// one, so once a board shows up a second time the same boards come back
+// forever. Boards are compared by a 64-bit hash of every agent and where it
+// is, which gameMove keeps up to date as agents move.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for equilibrium.h
+#ifndef _EQUILIBRIUM_H_
+#define _EQUILIBRIUM_H_
+
+#include <stdint.h>
+
+// Longest repeating sequence of boards that can be found
+#define EQUILIBRIUM_HISTORY 64
+
+
+/**
+ * Equilibrium holds the hashes of the most recent boards.
+ */
+typedef struct {
+    uint64_t hashes[EQUILIBRIUM_HISTORY];  // hash of board for recent cycles
+    int cycle;                             // cycle of the newest hash
+    int convergedCycle;                    // first cycle of the repeat
+    int period;                            // cycles between repeats, 0 if
+                                           // the board has not repeated
+} Equilibrium;
+
+
+/**
+ * initEquilibrium starts keeping track of the boards with the board for
+ * cycle 0.
+ *
+ * @param equilibrium  the history to initialize
+ * @param hash         the hash of the board at cycle 0
+ */
+void initEquilibrium(Equilibrium *equilibrium, uint64_t hash);
+
+
+/**
+ * checkEquilibrium adds the board for the next cycle and checks whether it
+ * matches one of the recent boards. A board that did not change at all has
+ * a period of 1.
+ *
+ * @param equilibrium  the history of recent boards
+ * @param hash         the hash of the board for the next cycle
+ * @returns            1 if the board has been seen before, in which case
+ *                     convergedCycle and period are set, 0 otherwise
+ */
+int checkEquilibrium(Equilibrium *equilibrium, uint64_t hash);
+
+
+// End include guard
+#endif
@@ -0,0 +1,72 @@
+//
+// File: game_types.h
+// Description: Provides the plain types shared by a game and whatever drives
+// it: the kernels that count neighbors, the ways a cycle can move agents,
+// and the statistics of a board after a cycle. They are kept out of
+// play_game.h, whose functions take 2D arrays C++ has no way to declare, so
+// simulation.h can hand them to C++ programs as well.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for game_types.h
+#ifndef _GAME_TYPES_H_
+#define _GAME_TYPES_H_
+
+#include <stddef.h>
+
+#include "agent_types.h"
+
+
+// Buckets in the happiness histogram, 10 points of happiness wide with the
+// last one only holding perfectly happy agents
+#define HAPPINESS_BUCKETS 11
+
+
+/**
+ * Kernel picks how gameMove and getBoardHappiness find the neighbor counts of
+ * a row. KERNEL_COUNTS reads counts kept up to date between cycles,
+ * KERNEL_CHAR compares the chars around each cell, KERNEL_PACKED adds up
+ * bitplanes of the board, and KERNEL_BOX slides a box filter down the board.
+ * All of them give the same counts, on a bounded board or a torus, but only
+ * KERNEL_BOX can count a neighborhood with a radius above 1.
+ */
+typedef enum {
+    KERNEL_COUNTS,
+    KERNEL_CHAR,
+    KERNEL_PACKED,
+    KERNEL_BOX
+} Kernel;
+
+
+/**
+ * UpdateMode picks how gameMove moves the unhappy agents of a cycle.
+ * UPDATE_SYNC finds all of them on the board as it was when the cycle
+ * started and moves them in row order. UPDATE_ASYNC moves one agent at a
+ * time, drawn at random from the agents that are unhappy right then, so
+ * every move sees the board the moves before it left.
+ */
+typedef enum {
+    UPDATE_SYNC,
+    UPDATE_ASYNC
+} UpdateMode;
+
+
+/**
+ * StepStats holds what gameStep finds out about the board after a cycle.
+ */
+typedef struct {
+    long moves;                            // moves made during the cycle
+    double happiness;                      // average happiness, 0 to 1
+    size_t agents;                         // chars of every type
+    size_t unhappy;                        // agents that will move next cycle
+    size_t histogram[HAPPINESS_BUCKETS];   // agents by happiness / 10
+    size_t typeAgents[MAX_TYPES];          // agents of each type
+    double typeHappiness[MAX_TYPES];       // average happiness of each type
+} StepStats;
+
+
+// End include guard
+#endif
@@ -1,3 +1,3 @@
 CFLAGS =	-std=c99 -ggdb -Wall -Wextra -pedantic
-CLIBFLAGS =	-lm  -lcurses 
+CLIBFLAGS =	-lm  -lcurses -pthread 
 
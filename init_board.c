@@ -2,8 +2,8 @@
 // File: init_board.c
 // Description: Contains a function used to initialize a 2D array of chars
 // with the correct number of each type of agent and vacant spaces, and a
-// function to randomly shuffle the agents around in the array from lowest
-// to highest index.
+// function to randomly shuffle the agents around in the array, both split
+// between threads a block of cells at a time.
 //
 // @author ldc1618: Luke Chelius
 //
@@ -17,70 +17,360 @@
 
 #include "init_board.h"
 
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+
+
+// Cells in each block that is shuffled on its own before the blocks are
+// merged, small enough for a block to stay in cache
+#define SHUFFLE_BLOCK_CELLS ((size_t)1 << 20)
+
+
+/**
+ * allocBoard(): Maps anonymous memory for the board and asks for it to be
+ * backed by huge pages, which cuts down on TLB misses for big boards.
+ */
+void *allocBoard(int dimensions) {
+
+    size_t size = (size_t)dimensions * dimensions;
+
+    void *board = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (board == MAP_FAILED) {
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(board, size, MADV_HUGEPAGE);  // Only a hint, so errors are fine
+#endif
+
+    return board;
+}
+
+
+/**
+ * freeBoard(): Unmaps the memory of the board.
+ */
+void freeBoard(int dimensions, void *board) {
+
+    if (board != NULL) {
+        munmap(board, (size_t)dimensions * dimensions);
+    }
+}
+
+
+/**
+ * InitWork is what the threads setting up a board share. Each task is split
+ * into items numbered from 0, and every item only touches its own cells and
+ * its own generator, so which thread runs it never changes the board.
+ */
+typedef struct {
+    char *cells;          // the board as one array
+    size_t totalSpaces;   // cells in the board
+    int numTypes;         // types of agents in the board
+    size_t runEnds[MAX_TYPES + 1];  // end of the vacant run, then of the
+                                    // run of each type after it
+    const Rng *streams;   // generator of every block and merge
+    size_t width;         // length of the runs being merged
+    size_t firstMerge;    // stream of the first merge of the level
+} InitWork;
+
+
+/**
+ * InitThread is one thread running every threads-th item of a task.
+ */
+typedef struct {
+    InitWork *work;                      // the work being shared
+    void (*task)(InitWork *, size_t);    // runs one item
+    size_t items;                        // items in the task
+    int threads;                         // threads sharing the task
+    int index;                           // first item of the thread
+    pthread_t thread;                    // the thread running the items
+    int running;                         // 1 while the thread is running
+} InitThread;
+
+
+/**
+ * runItems(): Runs the thread's share of the items.
+ */
+static void *runItems(void *arg) {
+
+    InitThread *initThread = arg;
+
+    for (size_t item = initThread->index; item < initThread->items;
+         item += initThread->threads) {
+        initThread->task(initThread->work, item);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * parallelFor(): Runs every item of a task, sharing them out between the
+ * threads. The first share runs on this thread, as does any share whose
+ * thread couldn't be started.
+ */
+static void parallelFor(InitWork *work, void (*task)(InitWork *, size_t),
+                        size_t items, int threads) {
+
+    // Every thread needs at least one item
+    if ((size_t)threads > items) {
+        threads = items;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    InitThread pool[threads];
+
+    for (int t = 0; t < threads; t++) {
+        pool[t].work = work;
+        pool[t].task = task;
+        pool[t].items = items;
+        pool[t].threads = threads;
+        pool[t].index = t;
+        pool[t].running = t > 0 && pthread_create(&pool[t].thread, NULL,
+                                                  runItems, &pool[t]) == 0;
+    }
+
+    runItems(&pool[0]);
+
+    for (int t = 1; t < threads; t++) {
+        if (pool[t].running) {
+            pthread_join(pool[t].thread, NULL);
+        }
+        else {
+            runItems(&pool[t]);
+        }
+    }
+}
+
+
+/**
+ * fillBlock(): Fills one block of the board with the part of the vacant run
+ * and the run of each type that falls inside it.
+ */
+static void fillBlock(InitWork *work, size_t item) {
+
+    size_t start = item * SHUFFLE_BLOCK_CELLS;
+    size_t end = start + SHUFFLE_BLOCK_CELLS;
+
+    if (end > work->totalSpaces) {
+        end = work->totalSpaces;
+    }
+
+    size_t runStart = start;  // Where the current run starts in the block
+
+    for (int k = 0; k <= work->numTypes; k++) {
+        char agent = k == 0 ? '.' : AGENT_CHARS[k - 1];
+
+        // Clamp the end of the run to the block
+        size_t runEnd = work->runEnds[k];
+        runEnd = runEnd < start ? start : runEnd > end ? end : runEnd;
+
+        memset(work->cells + runStart, agent, runEnd - runStart);
+        runStart = runEnd;
+    }
+}
+
 
 /**
  * populateBoard(): Initialize the indices of a 2D array with the appropriate
- * number of vacant, endline, and newline chars based on given percentages
- * of the board to be filled with each type of char.
+ * number of vacant chars and chars of each type based on given percentages
+ * of the board to be filled with each type of char. The vacant chars come
+ * first, then the chars of each type in order, with the last type taking
+ * whatever the others leave, and the threads each fill whole blocks of them.
  */
 void populateBoard(int dimensions, char board[dimensions][dimensions],
-                   int vacant, int endline) {
+                   int vacant, const int typePercents[], int numTypes,
+                   int threads) {
+
+    InitWork work;
 
     // Calculate total spaces in the board 2D array
-    int totalSpaces = dimensions * dimensions;
+    work.cells = (char *)board;
+    work.totalSpaces = (size_t)dimensions * dimensions;
+    work.numTypes = numTypes;
     // Calculate the number of vacant, '.', spots from the percentage given
-    int numVacant = totalSpaces * (vacant / 100.0);
-    // Calculate the number of endline, 'e', spots from percent given
-    int numEndline = (totalSpaces - numVacant) * (endline / 100.0);
-
-    // Nested loops to initialize the board with the correct number of each
-    // char, '.' for vacant, 'e' for endline, and 'n' for newline
-    for (int i = 0; i < dimensions; i++) {
-        for (int j = 0; j < dimensions; j++) {
-
-            // Put correct number of vacant chars
-            if (numVacant > 0) {
-                board[i][j] = '.';
-                numVacant--;
-            }
-            // Put correct number of endline chars
-            else if (numEndline > 0) {
-                board[i][j] = 'e';
-                numEndline--;
-            }
-            // Fill the rest with newline chars
-            else {
-                board[i][j] = 'n';
+    size_t numVacant = work.totalSpaces * (vacant / 100.0);
+    work.runEnds[0] = numVacant;
+
+    // Calculate the number of spots of each type from the percents given
+    for (int k = 0; k < numTypes - 1; k++) {
+        work.runEnds[k + 1] = work.runEnds[k] +
+                              (size_t)((work.totalSpaces - numVacant) *
+                                       (typePercents[k] / 100.0));
+    }
+    work.runEnds[numTypes] = work.totalSpaces;
+
+    parallelFor(&work, fillBlock,
+                (work.totalSpaces + SHUFFLE_BLOCK_CELLS - 1) /
+                SHUFFLE_BLOCK_CELLS, threads);
+}
+
+
+/**
+ * shuffleBlock(): Uses the Fisher-Yates shuffle algorithm to randomize one
+ * block of the board with its own generator, swapping each cell from the
+ * end down with a random cell at or before it.
+ */
+static void shuffleBlock(InitWork *work, size_t item) {
+
+    size_t start = item * SHUFFLE_BLOCK_CELLS;
+    size_t end = start + SHUFFLE_BLOCK_CELLS;
+    Rng rng = work->streams[item];
+    char *cells = work->cells;
+
+    if (end > work->totalSpaces) {
+        end = work->totalSpaces;
+    }
+
+    for (size_t i = end - 1; i > start; i--) {
+        size_t swapIndex = start + rngBelow(&rng, i - start + 1);
+        char temp = cells[i];
+
+        cells[i] = cells[swapIndex];
+        cells[swapIndex] = temp;
+    }
+}
+
+
+/**
+ * mergeRuns(): Merges two shuffled runs next to each other into one shuffled
+ * run in place. A random bit picks whether the next cell comes from the
+ * first run or the second until one of them runs out, and the cells left
+ * over are then put in random places with Fisher-Yates, which keeps every
+ * order of the merged run equally likely.
+ */
+static void mergeRuns(InitWork *work, size_t item) {
+
+    size_t start = item * 2 * work->width;
+    size_t mid = start + work->width;
+    size_t end = mid + work->width;
+    Rng rng = work->streams[work->firstMerge + item];
+    char *cells = work->cells;
+
+    // The last run of a level has nothing to merge with
+    if (mid >= work->totalSpaces) {
+        return;
+    }
+    if (end > work->totalSpaces) {
+        end = work->totalSpaces;
+    }
+
+    size_t i = start;  // Next cell of the merged run
+    size_t j = mid;  // Next cell of the second run
+    uint64_t bits = 0;  // Random bits not used yet
+    int numBits = 0;  // Number of them
+
+    // Neither run can be used up within the next 64 bits while the second
+    // run has 64 cells left and more than 64 cells separate i and j, so
+    // whole words of bits are used without checking
+    while (end - j >= 64 && j - i > 64) {
+        uint64_t word = rngNext(&rng);
+
+        for (int b = 0; b < 64; b++) {
+            size_t fromSecond = (word >> b) & 1;
+            // Swap the cell with itself when it comes from the first run,
+            // which keeps the loop free of branches the bits would mispredict
+            size_t from = i + ((j - i) & -fromSecond);
+            char temp = cells[i];
+
+            cells[i] = cells[from];
+            cells[from] = temp;
+            j += fromSecond;
+            i++;
+        }
+    }
+
+    for (;;) {
+        if (numBits == 0) {
+            bits = rngNext(&rng);
+            numBits = 64;
+        }
+
+        int fromSecond = bits & 1;
+        bits >>= 1;
+        numBits--;
+
+        if (fromSecond) {
+            if (j == end) {
+                break;
             }
+
+            char temp = cells[i];
+            cells[i] = cells[j];
+            cells[j] = temp;
+            j++;
         }
+        else if (i == j) {
+            break;
+        }
+
+        i++;
+    }
+
+    for (; i < end; i++) {
+        size_t swapIndex = start + rngBelow(&rng, i - start + 1);
+        char temp = cells[i];
+
+        cells[i] = cells[swapIndex];
+        cells[swapIndex] = temp;
     }
 }
 
 
 /**
- * shuffle(): Uses the Fisher-Yates shuffle algorithm to randomize the contents
- * of a 2D array from low to high index.
+ * shuffle(): Randomizes the contents of a 2D array with MergeShuffle. Each
+ * block is shuffled on its own, then neighboring runs are merged in pairs,
+ * doubling their length each level until the whole board is one run. Every
+ * block and every merge has its own stream of the generator, so the threads
+ * only change how fast the board is shuffled, not how it ends up.
  */
-void shuffle(int dimensions, char board[dimensions][dimensions]) {
+int shuffle(int dimensions, char board[dimensions][dimensions], Rng *rng,
+            int threads) {
 
-    srandom(time(NULL));  // Uses time(NULL) for dynamic randomization
+    InitWork work;
+    work.cells = (char *)board;
+    work.totalSpaces = (size_t)dimensions * dimensions;
 
-    // For loop to go through each index in the 2D array
-    for (int i = 0; i < dimensions * dimensions - 2; i++) {
+    size_t numBlocks = (work.totalSpaces + SHUFFLE_BLOCK_CELLS - 1) /
+                       SHUFFLE_BLOCK_CELLS;
+    size_t numStreams = numBlocks;  // A stream for each block and merge
 
-        // Get a random number and modulo it by the size of the array, adding
-        // the current index to swap it with a higher index in the array
-        long int swapIndex = random() % (dimensions * dimensions - i) + i;
+    for (size_t width = SHUFFLE_BLOCK_CELLS; width < work.totalSpaces;
+         width *= 2) {
+        numStreams += (work.totalSpaces + 2 * width - 1) / (2 * width);
+    }
+
+    Rng *streams = malloc(numStreams * sizeof(Rng));
+    if (streams == NULL) {
+        return 0;
+    }
 
-        // Temporary variable to hold the current index value
-        char temp = board[i / dimensions][i % dimensions];
+    // Split the generator into streams, then move it past all of them so
+    // anything it is used for next gets numbers of its own
+    for (size_t k = 0; k < numStreams; k++) {
+        streams[k] = *rng;
+        rngJump(rng);
+    }
+    work.streams = streams;
 
-        // Swap the random index with the current index
-        board[i / dimensions][i % dimensions] =
-                board[swapIndex / dimensions][swapIndex % dimensions];
+    parallelFor(&work, shuffleBlock, numBlocks, threads);
 
-        // Set the random index to temp which holds the current index's old
-        // value
-        board[swapIndex / dimensions][swapIndex % dimensions] = temp;
+    work.firstMerge = numBlocks;
+    for (work.width = SHUFFLE_BLOCK_CELLS; work.width < work.totalSpaces;
+         work.width *= 2) {
+        size_t numMerges = (work.totalSpaces + 2 * work.width - 1) /
+                           (2 * work.width);
+
+        parallelFor(&work, mergeRuns, numMerges, threads);
+        work.firstMerge += numMerges;
     }
+
+    free(streams);
+
+    return 1;
 }
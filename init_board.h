@@ -1,10 +1,13 @@
 //
 // File: init_board.h
 // Description: Provides functions for initializing and shuffling a 2D array 
-//              of chars with vacant ('.'), endline ('e'), and newline ('n')
-//              chars. It uses the Fisher-Yates shuffle algorithm to randomize
-//              the position of the chars in the board from lowest to highest
-//              index.
+//              of chars with vacant ('.') chars and the chars of each type of
+//              agent, such as endline ('e') and newline ('n'). It uses the
+//              MergeShuffle algorithm to randomize the position of the chars
+//              in the board, shuffling blocks with Fisher-Yates on several
+//              threads and merging them in pairs, which gives every order of
+//              the chars the same chance and the same board for a seed
+//              however many threads are used.
 //
 // @author ldc1618: Luke Chelius
 //
@@ -18,38 +21,81 @@
 #define _DEFAULT_SOURCE
 #endif
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <time.h>
 
+#include "agent_types.h"
+#include "rng.h"
+
+
+// Largest width and height of the board that can be allocated
+#define MAX_DIMENSIONS 100000
+
 
 /**
- * populateBoard fills a 2D array of chars with the correct percentages of
- * vacant, endline, and newline chars from the supplied percentages given.
+ * allocBoard allocates the memory for a square 2D array of chars once, for
+ * the whole run. Large boards are mapped so the kernel can back them with
+ * huge pages instead of putting them on the stack.
+ *
+ * @param dimensions  the size of the square 2D array to allocate
+ * @returns           the memory for the board, to be used as
+ *                    char board[dimensions][dimensions], or NULL if it could
+ *                    not be allocated
+ */
+void *allocBoard(int dimensions);
+
+
+/**
+ * freeBoard releases the memory of a board allocated by allocBoard.
  *
  * @param dimensions  the size of the square 2D array given
- * @param board       a 2D array of size dimensions that will be filled with
- *                    vacant, endline, and newline chars in that order
- * @param vacant      the percentage of the spaces in board to be filled
- *                    with vacant chars
- * @param endline     the percentage of the remaining spaces in board to be
- *                    filled with endline chars
+ * @param board       the board to free
+ */
+void freeBoard(int dimensions, void *board);
+
+
+/**
+ * populateBoard fills a 2D array of chars with the correct percentages of
+ * vacant chars and chars of each type of agent from the supplied
+ * percentages given.
+ *
+ * @param dimensions    the size of the square 2D array given
+ * @param board         a 2D array of size dimensions that will be filled
+ *                      with vacant chars, then the chars of each type in
+ *                      the order of AGENT_CHARS
+ * @param vacant        the percentage of the spaces in board to be filled
+ *                      with vacant chars
+ * @param typePercents  the percentage of the remaining spaces in board to
+ *                      be filled with each type, where the last type gets
+ *                      every space the others leave
+ * @param numTypes      the number of types, from 2 to MAX_TYPES
+ * @param threads       the number of threads filling the board, which also
+ *                      spreads its pages over their memory
  */
 void populateBoard(int dimensions, char board[dimensions][dimensions],
-                   int vacant, int endline);
+                   int vacant, const int typePercents[], int numTypes,
+                   int threads);
 
 
 /**
- * shuffle uses the Fisher-Yates shuffle algorithm to randomly swap the
- * indices of a 2D array from lowest to highest index. The Fisher-Yates
- * algorithm operated on a single array, so in order to use a 2D array
- * the index needs to be divided by 5 to get the row, and modulus 5 for the
- * column.
+ * shuffle uses the MergeShuffle algorithm to randomly reorder the chars of
+ * a 2D array, treated as a single array. Blocks of it are shuffled with
+ * Fisher-Yates, then pairs of shuffled runs are merged until only one is
+ * left. Every block and merge takes its own stream of the generator, so
+ * any number of threads gives the same board, and every order of the chars
+ * is equally likely.
  *
  * @param dimensions  the size of the square 2D array given
  * @param board       a 2D array of chars that will have its values randomly
  *                    swapped by the algorithm
+ * @param rng         the generator the streams are split from, left past
+ *                    all of them
+ * @param threads     the number of threads shuffling the board
+ * @returns           1 if the board was shuffled, 0 if memory ran out
  */
-void shuffle(int dimensions, char board[dimensions][dimensions]);
+int shuffle(int dimensions, char board[dimensions][dimensions], Rng *rng,
+            int threads);
 
 
 // End header guard
@@ -0,0 +1,173 @@
+//
+// File: metrics.c
+// Description: Contains the functions for the per-cycle metrics stream. The
+// simulation fills the slot at tail and then publishes it by storing the new
+// tail with release order, and the writer reads tail with acquire order
+// before reading the slots, so it never sees a slot half filled. Freeing
+// slots works the same way in the other direction with head.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "metrics.h"
+
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+// Microseconds the writer sleeps for when the ring is empty
+#define METRICS_IDLE_SLEEP 1000
+
+
+/**
+ * writeRecord(): Writes one record as a CSV row, with the happiness of each
+ * type at the end.
+ */
+static void writeRecord(Metrics *metrics, const MetricsRecord *record) {
+
+    int written = fprintf(metrics->file, "%d,%ld,%lf,%zu", record->cycle,
+                          record->moves, record->happiness, record->unhappy);
+
+    for (int k = 0; k < metrics->numTypes && written >= 0; k++) {
+        written = fprintf(metrics->file, ",%lf", record->typeHappiness[k]);
+    }
+    if (written < 0 || fputc('\n', metrics->file) == EOF) {
+        metrics->failed = 1;
+    }
+}
+
+
+/**
+ * runWriter(): Writes every record published so far, freeing each slot as it
+ * goes, flushes them once the ring is empty, and sleeps while it stays
+ * empty. Once closing is set it makes one more pass, since records pushed
+ * before closing are published by then.
+ */
+static void *runWriter(void *arg) {
+
+    Metrics *metrics = arg;
+    size_t head = metrics->head;  // Only this thread moves head
+
+    for (;;) {
+        int closing = __atomic_load_n(&metrics->closing, __ATOMIC_ACQUIRE);
+        size_t tail = __atomic_load_n(&metrics->tail, __ATOMIC_ACQUIRE);
+
+        if (head != tail) {
+            while (head != tail) {
+                writeRecord(metrics, &metrics->ring[head &
+                                                     (METRICS_RING_SIZE - 1)]);
+                head++;
+                __atomic_store_n(&metrics->head, head, __ATOMIC_RELEASE);
+            }
+
+            // Infinite mode only ends with Control-C, which never reaches
+            // closeMetrics, so nothing is left sitting in the buffer
+            if (fflush(metrics->file) == EOF) {
+                metrics->failed = 1;
+            }
+        }
+
+        if (closing) {
+            break;
+        }
+        usleep(METRICS_IDLE_SLEEP);
+    }
+
+    return NULL;
+}
+
+
+/**
+ * openMetrics(): Opens the file and allocates the ring, then writes the
+ * header and starts the writer.
+ */
+int openMetrics(Metrics *metrics, const char *path, int numTypes) {
+
+    metrics->numTypes = numTypes;
+    metrics->head = 0;
+    metrics->tail = 0;
+    metrics->closing = 0;
+    metrics->failed = 0;
+    metrics->running = 0;
+    metrics->ring = malloc(METRICS_RING_SIZE * sizeof(MetricsRecord));
+    metrics->file = fopen(path, "w");
+
+    if (metrics->ring == NULL || metrics->file == NULL) {
+        free(metrics->ring);
+        if (metrics->file != NULL) {
+            fclose(metrics->file);
+        }
+        return 0;
+    }
+
+    fprintf(metrics->file, "cycle,moves,happiness,unhappy");
+    for (int k = 0; k < numTypes; k++) {
+        fprintf(metrics->file, ",%c_happiness", AGENT_CHARS[k]);
+    }
+    fprintf(metrics->file, "\n");
+
+    metrics->running = pthread_create(&metrics->thread, NULL, runWriter,
+                                      metrics) == 0;
+
+    return 1;
+}
+
+
+/**
+ * pushMetrics(): Fills the slot at tail and publishes it, yielding to the
+ * writer while the ring is full. Without a writer thread the record is
+ * written and flushed straight away.
+ */
+void pushMetrics(Metrics *metrics, int cycle, const StepStats *stats) {
+
+    size_t tail = metrics->tail;  // Only this thread moves tail
+
+    if (metrics->running) {
+        while (tail - __atomic_load_n(&metrics->head, __ATOMIC_ACQUIRE) ==
+               METRICS_RING_SIZE) {
+            sched_yield();
+        }
+    }
+
+    MetricsRecord *record = &metrics->ring[tail & (METRICS_RING_SIZE - 1)];
+    record->cycle = cycle;
+    record->moves = stats->moves;
+    record->happiness = stats->happiness;
+    record->unhappy = stats->unhappy;
+    for (int k = 0; k < metrics->numTypes; k++) {
+        record->typeHappiness[k] = stats->typeHappiness[k];
+    }
+
+    if (!metrics->running) {
+        writeRecord(metrics, record);
+        if (fflush(metrics->file) == EOF) {
+            metrics->failed = 1;
+        }
+        return;
+    }
+
+    __atomic_store_n(&metrics->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * closeMetrics(): Tells the writer no more records are coming, waits for it
+ * to empty the ring, then closes the file and frees the ring.
+ */
+int closeMetrics(Metrics *metrics) {
+
+    if (metrics->running) {
+        __atomic_store_n(&metrics->closing, 1, __ATOMIC_RELEASE);
+        pthread_join(metrics->thread, NULL);
+    }
+
+    if (fclose(metrics->file) == EOF) {
+        metrics->failed = 1;
+    }
+    free(metrics->ring);
+
+    return !metrics->failed;
+}
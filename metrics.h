@@ -0,0 +1,100 @@
+//
+// File: metrics.h
+// Description: Provides a stream of one CSV row per cycle with the moves,
+// happiness, and unhappy agents of the board, for runs where the time series
+// is wanted instead of every board. The rows are handed to a writer thread
+// through a single-producer, single-consumer ring of records, so the cycles
+// never wait on the disk unless the ring fills up.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for metrics.h
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "agent_types.h"
+#include "play_game.h"
+
+
+// Records the ring holds, a power of two so positions wrap with a mask
+#define METRICS_RING_SIZE 4096
+
+
+/**
+ * MetricsRecord is what is written about the board after one cycle.
+ */
+typedef struct {
+    int cycle;                         // the cycle the board is on
+    long moves;                        // moves made during the cycle
+    double happiness;                  // average happiness, 0 to 1
+    size_t unhappy;                    // agents that will move next cycle
+    double typeHappiness[MAX_TYPES];   // average happiness of each type
+} MetricsRecord;
+
+
+/**
+ * Metrics holds the file being written and the ring between the simulation
+ * and the writer thread. Only the simulation moves tail and only the writer
+ * moves head, so neither needs a lock, just atomic loads and stores that
+ * order the records with the positions.
+ */
+typedef struct {
+    FILE *file;                 // the CSV file being written
+    int numTypes;               // types of agents in the board
+    MetricsRecord *ring;        // METRICS_RING_SIZE records
+    size_t head;                // next record the writer takes
+    size_t tail;                // next slot the simulation fills
+    int closing;                // boolean, true once no more records come
+    int failed;                 // boolean, true if a write failed
+    pthread_t thread;           // the writer thread
+    int running;                // 1 while the writer thread is running
+} Metrics;
+
+
+/**
+ * openMetrics creates the file, writes the header row, and starts the writer
+ * thread. If the thread can't be started the rows are written as they come
+ * instead.
+ *
+ * @param metrics   the stream to open
+ * @param path      the name of the CSV file to write
+ * @param numTypes  the number of types of agents, from 2 to MAX_TYPES
+ * @returns         1 if the file was opened, 0 if it or the ring couldn't be
+ */
+int openMetrics(Metrics *metrics, const char *path, int numTypes);
+
+
+/**
+ * pushMetrics adds the row of one cycle, only waiting if the writer is a
+ * whole ring behind.
+ *
+ * @param metrics  the open stream
+ * @param cycle    the cycle the board is on
+ * @param stats    the statistics of the board after the cycle
+ */
+void pushMetrics(Metrics *metrics, int cycle, const StepStats *stats);
+
+
+/**
+ * closeMetrics waits for the writer to finish the rows left in the ring,
+ * then closes the file.
+ *
+ * @param metrics  the stream to close
+ * @returns        1 if every row was written, 0 if a write failed
+ */
+int closeMetrics(Metrics *metrics);
+
+
+// End include guard
+#endif
@@ -0,0 +1,926 @@
+//
+// File: microbench.c
+// Description: Times the kernels the simulation spends its cycles in,
+// getHappiness, moveAgent, gameMove, shuffle, and getBoardHappiness, on
+// boards of several sizes, vacancies, and strengths of preference. Every
+// case is run a few times untimed to warm the caches, then sampled a number
+// of times in each of a few passes over all the cases, so its samples are
+// spread out over the whole run. Other load on the machine can only slow a
+// sample down, so the fastest sample is the time a case is judged by, and
+// the median and 95th percentile are reported alongside it. The results can
+// be saved to a file, and compared with a file saved before. A case is
+// slower than before if its fastest sample is slower than the saved one by
+// more than the threshold, and such a case is sampled in CONFIRM_PASSES more
+// passes once the others are done, and only fails if the fastest of all its
+// samples still is. make bench, make bench-baseline, and make bench-compare
+// run it this way, and make bench-selftest checks that the comparison fails
+// every case against a baseline a third faster than the code.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "agent_types.h"
+#include "counters.h"
+#include "init_board.h"
+#include "play_game.h"
+
+
+// Runs of a case made untimed before the timed ones
+#define WARMUP_RUNS 2
+
+// Timed samples of a case in each pass by default, and the most that can
+// be asked for
+#define DEFAULT_SAMPLES 15
+#define MAX_SAMPLES 101
+
+// Passes over every case by default, and the most that can be asked for
+#define DEFAULT_PASSES 3
+#define MAX_PASSES 10
+
+// Least time a sample is timed for, repeating the run until it has been
+#define MIN_SAMPLE_SECONDS 0.01
+
+// Percent the fastest sample can grow by before the case counts as a
+// regression
+#define DEFAULT_THRESHOLD 15.0
+
+// Room for the name of a case, and for every case that can be run
+#define CASE_NAME_SIZE 64
+#define MAX_CASES 128
+
+// Passes a slower case is sampled in again, after every case has been
+// compared, before the fastest of all its samples decides if it regressed
+#define CONFIRM_PASSES 2
+
+// Room for every sample of a case
+#define MAX_CASE_SAMPLES (MAX_SAMPLES * (MAX_PASSES + CONFIRM_PASSES))
+
+// First line of a results file, which a file must start with to be compared
+#define RESULTS_HEADER "# microbench results: case unit fastest_ns median_ns " \
+                       "p95_ns\n"
+
+// Room for a line of a results file
+#define RESULT_LINE_SIZE 256
+
+// Seed every board is shuffled with, so each run times the same boards
+#define BENCH_SEED 1
+
+
+// Sizes of the boards timed
+static const int benchSizes[] = {64, 256, 1024};
+
+// Vacancies of the boards timed
+static const int benchVacancies[] = {10, 30};
+
+// Strengths of preference gameMove is timed at
+static const int benchStrengths[] = {30, 70};
+
+// Kernels timed, and their names as the --kernel flag takes them
+static const Kernel benchKernels[] = {KERNEL_COUNTS, KERNEL_CHAR,
+                                      KERNEL_PACKED, KERNEL_BOX};
+static const char *kernelNames[] = {"counts", "char", "packed", "box"};
+
+#define NUM_ITEMS(array) ((int)(sizeof(array) / sizeof((array)[0])))
+
+
+/**
+ * Bench is one case being timed: its board and the state its runs share.
+ */
+typedef struct {
+    int dimensions;         // the size of the board
+    int strength;           // the strength of preference gameMove uses
+    Kernel kernel;          // the kernel the game is set up with
+    char *start;            // the shuffled board every run starts from
+    char *board;            // the board a run works on, mapped again for
+                            // every sample
+    Game game;              // a game for board, for the runs that only read
+    int gameReady;          // boolean, true once game has been set up for
+                            // the board of this sample
+    size_t ops;             // the cells, moves, or calls the last run timed
+} Bench;
+
+
+/**
+ * BenchRun is a run of one kernel, which sets up what it needs untimed,
+ * then times the kernel.
+ *
+ * @param bench  the case being run
+ * @returns      the seconds the kernel took, or a negative number if memory
+ *               ran out
+ */
+typedef double (*BenchRun)(Bench *bench);
+
+
+/**
+ * Result is a case and its samples of the time per op, in nanoseconds.
+ */
+typedef struct {
+    char name[CASE_NAME_SIZE];   // the kernel and the board it was timed on
+    const char *unit;            // what an op is: a cell, move, or call
+    BenchRun run;                // the run of the kernel to time
+    int dimensions;              // the size of the board
+    int vacancy;                 // the percentage of the board that is vacant
+    int strength;                // the strength of preference gameMove uses
+    Kernel kernel;               // the kernel the game is set up with
+    double times[MAX_CASE_SAMPLES];  // every sample taken so far
+    int numTimes;                // the number of samples in times
+    double fastest;              // the fastest of the samples
+    double median;               // the median of the samples
+    double p95;                  // the 95th percentile of the samples
+} Result;
+
+
+/**
+ * printUsage prints the flags of the program.
+ *
+ * @param out  the stream to write to
+ */
+static void printUsage(FILE *out) {
+
+    fprintf(out, "usage: microbench [-h] [-r samples] [-n passes] "
+                 "[-f filter] [-o file]\n"
+                 "                  [-c file] [-t percent] [-a]\n");
+    fprintf(out, "  -h          print this message and exit\n");
+    fprintf(out, "  -r samples  timed samples of each case in each pass, "
+                 "from 1 to %d\n"
+                 "              (default %d)\n", MAX_SAMPLES,
+            DEFAULT_SAMPLES);
+    fprintf(out, "  -n passes   passes over every case, from 1 to %d "
+                 "(default %d)\n", MAX_PASSES, DEFAULT_PASSES);
+    fprintf(out, "  -f filter   only run the cases whose names contain "
+                 "filter\n");
+    fprintf(out, "  -o file     save the results to file\n");
+    fprintf(out, "  -c file     compare the results with those saved in "
+                 "file, failing if\n"
+                 "              the fastest sample of any case is slower by "
+                 "more than the\n"
+                 "              threshold, and still is once it has been "
+                 "sampled more\n");
+    fprintf(out, "  -t percent  the threshold for -c (default %.0f)\n",
+            DEFAULT_THRESHOLD);
+    fprintf(out, "  -a          with -c, fail unless every case is slower, "
+                 "to check that the\n"
+                 "              comparison catches a regression\n");
+}
+
+
+/**
+ * setupGame sets up a game for the board of a case as it is now.
+ *
+ * @param bench  the case to set the game up for
+ * @param game   the game to set up
+ * @returns      1 if the game was set up, 0 if memory ran out
+ */
+static int setupGame(Bench *bench, Game *game) {
+
+    int dimensions = bench->dimensions;
+
+    return initGame(game, dimensions,
+                    (char (*)[dimensions])bench->board, 2, 1, 0,
+                    bench->kernel, 1);
+}
+
+
+/**
+ * restoreBoard copies the starting board of a case into the board its runs
+ * work on.
+ *
+ * @param bench  the case to restore
+ */
+static void restoreBoard(Bench *bench) {
+
+    memcpy(bench->board, bench->start,
+           (size_t)bench->dimensions * bench->dimensions);
+}
+
+
+/**
+ * runGetHappiness times getHappiness on every agent of the board.
+ *
+ * @param bench  the case being run
+ * @returns      the seconds taken
+ */
+static double runGetHappiness(Bench *bench) {
+
+    int dimensions = bench->dimensions;
+    char (*board)[dimensions] = (char (*)[dimensions])bench->board;
+    volatile double sink = 0.0;  // Keeps the calls from being optimized out
+    size_t agents = 0;
+
+    double start = countersClock();
+    for (int row = 0; row < dimensions; row++) {
+        for (int col = 0; col < dimensions; col++) {
+            if (board[row][col] != '.') {
+                sink += getHappiness(dimensions, board, row, col);
+                agents++;
+            }
+        }
+    }
+    double seconds = countersClock() - start;
+
+    (void)sink;
+    bench->ops = agents;
+    return seconds;
+}
+
+
+/**
+ * runShuffle times shuffling the starting board again on one thread.
+ *
+ * @param bench  the case being run
+ * @returns      the seconds taken, or -1 if memory ran out
+ */
+static double runShuffle(Bench *bench) {
+
+    int dimensions = bench->dimensions;
+    Rng rng;
+
+    restoreBoard(bench);
+    seedRng(&rng, BENCH_SEED);
+
+    double start = countersClock();
+    int shuffled = shuffle(dimensions, (char (*)[dimensions])bench->board,
+                           &rng, 1);
+    double seconds = countersClock() - start;
+
+    bench->ops = (size_t)dimensions * dimensions;
+    return shuffled ? seconds : -1.0;
+}
+
+
+/**
+ * runMoveAgent times moving agents in row order, alternating between the
+ * first and last vacant spot, until every vacant spot has been taken.
+ *
+ * @param bench  the case being run
+ * @returns      the seconds taken, or -1 if memory ran out
+ */
+static double runMoveAgent(Bench *bench) {
+
+    int dimensions = bench->dimensions;
+    char (*board)[dimensions] = (char (*)[dimensions])bench->board;
+    Game game;
+    size_t moves = 0;
+    int full = 0;  // Boolean, true once no vacant spot is left
+
+    restoreBoard(bench);
+    if (!setupGame(bench, &game)) {
+        return -1.0;
+    }
+
+    double start = countersClock();
+    for (int row = 0; row < dimensions && !full; row++) {
+        for (int col = 0; col < dimensions && !full; col++) {
+            if (board[row][col] == '.') {
+                continue;
+            }
+            full = !moveAgent(&game, dimensions, board, row, col, moves % 2);
+            moves += !full;
+        }
+    }
+    double seconds = countersClock() - start;
+
+    freeGame(&game);
+    bench->ops = moves;
+    return seconds;
+}
+
+
+/**
+ * runGameMove times the second cycle of a game, after an untimed first cycle
+ * has found every unhappy agent, so it is the cost of a cycle once the game
+ * is under way. Its time is per cell of the board.
+ *
+ * @param bench  the case being run
+ * @returns      the seconds taken, or -1 if memory ran out
+ */
+static double runGameMove(Bench *bench) {
+
+    int dimensions = bench->dimensions;
+    char (*board)[dimensions] = (char (*)[dimensions])bench->board;
+    Game game;
+
+    restoreBoard(bench);
+    if (!setupGame(bench, &game)) {
+        return -1.0;
+    }
+    gameMove(&game, dimensions, board, bench->strength);
+
+    double start = countersClock();
+    gameMove(&game, dimensions, board, bench->strength);
+    double seconds = countersClock() - start;
+
+    freeGame(&game);
+    bench->ops = (size_t)dimensions * dimensions;
+    return seconds;
+}
+
+
+/**
+ * runBoardHappiness times getBoardHappiness on the starting board, with the
+ * game for it set up on the first run of a sample and kept for the rest. Its
+ * time is per cell of the board.
+ *
+ * @param bench  the case being run
+ * @returns      the seconds taken, or -1 if memory ran out
+ */
+static double runBoardHappiness(Bench *bench) {
+
+    int dimensions = bench->dimensions;
+    double typeHappiness[MAX_TYPES];
+
+    if (!bench->gameReady) {
+        restoreBoard(bench);
+        if (!setupGame(bench, &bench->game)) {
+            return -1.0;
+        }
+        bench->gameReady = 1;
+    }
+
+    double start = countersClock();
+    getBoardHappiness(&bench->game, dimensions,
+                      (char (*)[dimensions])bench->board, typeHappiness);
+    double seconds = countersClock() - start;
+
+    bench->ops = (size_t)dimensions * dimensions;
+    return seconds;
+}
+
+
+/**
+ * compareDoubles orders doubles from smallest to largest for qsort.
+ *
+ * @param a  the first double
+ * @param b  the second double
+ * @returns  negative, zero, or positive as a is below, equal to, or above b
+ */
+static int compareDoubles(const void *a, const void *b) {
+
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+/**
+ * remapBoard maps a new board for the runs of a case to work on, filled
+ * with the starting board, and drops the last one along with any game set
+ * up for it. The cache sets a board's pages land in decide whether a case
+ * runs fast or slow for as long as it keeps them, so every sample gets its
+ * own pages and its samples are spread across many placements.
+ *
+ * @param bench  the case being run
+ * @returns      1 if the board was mapped, 0 if memory ran out
+ */
+static int remapBoard(Bench *bench) {
+
+    char *board = allocBoard(bench->dimensions);
+
+    if (board == NULL) {
+        return 0;
+    }
+
+    if (bench->gameReady) {
+        freeGame(&bench->game);
+        bench->gameReady = 0;
+    }
+    if (bench->board != NULL) {
+        freeBoard(bench->dimensions, bench->board);
+    }
+
+    bench->board = board;
+    restoreBoard(bench);
+    return 1;
+}
+
+
+/**
+ * percentile finds a percentile of sorted samples, going linearly between
+ * the two samples on either side of it, so a high percentile of a few
+ * samples isn't simply the slowest one.
+ *
+ * @param times    the samples, sorted from fastest to slowest
+ * @param samples  the number of samples
+ * @param percent  the percentile to find, from 0 to 100
+ * @returns        the percentile of the samples
+ */
+static double percentile(const double times[], int samples, double percent) {
+
+    double rank = percent / 100 * (samples - 1);
+    int below = (int)rank;
+
+    if (below >= samples - 1) {
+        return times[samples - 1];
+    }
+
+    return times[below] + (rank - below) * (times[below + 1] - times[below]);
+}
+
+
+/**
+ * sampleCase sets up the board of a case, runs it untimed WARMUP_RUNS
+ * times, then takes samples of it, each on a newly mapped board and from as
+ * many runs as it takes to time MIN_SAMPLE_SECONDS, adding them to the
+ * case's samples and finding their fastest, median, and 95th percentile
+ * again.
+ *
+ * @param result   the case to sample
+ * @param samples  the number of samples to take
+ * @returns        1 if the case was timed, 0 if memory ran out
+ */
+static int sampleCase(Result *result, int samples) {
+
+    int dimensions = result->dimensions;
+    BenchRun run = result->run;
+    int typePercents[2] = {60, 40};
+    double sorted[MAX_CASE_SAMPLES];
+    Bench bench;
+    Rng rng;
+    int ok = 1;
+
+    bench.dimensions = dimensions;
+    bench.strength = result->strength;
+    bench.kernel = result->kernel;
+    bench.gameReady = 0;
+    bench.start = allocBoard(dimensions);
+    bench.board = NULL;
+
+    if (bench.start == NULL) {
+        ok = 0;
+    }
+    else {
+        char (*start)[dimensions] = (char (*)[dimensions])bench.start;
+
+        seedRng(&rng, BENCH_SEED);
+        populateBoard(dimensions, start, result->vacancy, typePercents, 2,
+                      1);
+        ok = shuffle(dimensions, start, &rng, 1) && remapBoard(&bench);
+    }
+
+    for (int r = 0; ok && r < WARMUP_RUNS; r++) {
+        ok = run(&bench) >= 0;
+    }
+
+    for (int r = 0; ok && r < samples; r++) {
+        double seconds = 0.0;  // Time taken by the runs of this sample
+        size_t ops = 0;        // Ops timed by the runs of this sample
+
+        ok = remapBoard(&bench);
+        while (ok && seconds < MIN_SAMPLE_SECONDS) {
+            double runSeconds = run(&bench);
+
+            ok = runSeconds >= 0;
+            seconds += runSeconds;
+            ops += bench.ops;
+        }
+        if (ok && result->numTimes < MAX_CASE_SAMPLES) {
+            result->times[result->numTimes++] = ops > 0 ?
+                                                seconds * 1e9 / ops : 0.0;
+        }
+    }
+
+    if (bench.gameReady) {
+        freeGame(&bench.game);
+    }
+    if (bench.start != NULL) {
+        freeBoard(dimensions, bench.start);
+    }
+    if (bench.board != NULL) {
+        freeBoard(dimensions, bench.board);
+    }
+
+    if (!ok) {
+        return 0;
+    }
+
+    memcpy(sorted, result->times, result->numTimes * sizeof(double));
+    qsort(sorted, result->numTimes, sizeof(double), compareDoubles);
+    result->fastest = sorted[0];
+    result->median = percentile(sorted, result->numTimes, 50);
+    result->p95 = percentile(sorted, result->numTimes, 95);
+
+    return 1;
+}
+
+
+/**
+ * addCase names a case and adds it to the cases to run if it passes the
+ * filter.
+ *
+ * @param results     the cases so far, with this case added to the end
+ * @param numResults  the number of cases, counted up if the case is added
+ * @param filter      text the name must contain, or NULL for every case
+ * @param name        the name of the case
+ * @param unit        what one op of the case is
+ * @param run         the run of the kernel to time
+ * @param dimensions  the size of the board
+ * @param vacancy     the percentage of the board that is vacant
+ * @param strength    the strength of preference gameMove uses
+ * @param kernel      the kernel the game is set up with
+ * @returns           1 unless there are too many cases
+ */
+static int addCase(Result results[], int *numResults, const char *filter,
+                   const char *name, const char *unit, BenchRun run,
+                   int dimensions, int vacancy, int strength,
+                   Kernel kernel) {
+
+    if (filter != NULL && strstr(name, filter) == NULL) {
+        return 1;
+    }
+    if (*numResults >= MAX_CASES) {
+        fprintf(stderr, "microbench: more than %d cases\n", MAX_CASES);
+        return 0;
+    }
+
+    Result *result = &results[*numResults];
+    snprintf(result->name, CASE_NAME_SIZE, "%s", name);
+    result->unit = unit;
+    result->run = run;
+    result->dimensions = dimensions;
+    result->vacancy = vacancy;
+    result->strength = strength;
+    result->kernel = kernel;
+    result->numTimes = 0;
+
+    (*numResults)++;
+    return 1;
+}
+
+
+/**
+ * listCases lists every case that passes the filter: getHappiness,
+ * moveAgent, and shuffle for each size and vacancy, and gameMove and
+ * getBoardHappiness for each kernel as well, with gameMove at each strength
+ * too.
+ *
+ * @param results  filled with every case to run
+ * @param filter   text a case's name must contain, or NULL for every case
+ * @returns        the number of cases, or -1 if there are too many
+ */
+static int listCases(Result results[], const char *filter) {
+
+    char name[CASE_NAME_SIZE];
+    int numResults = 0;
+
+    for (int s = 0; s < NUM_ITEMS(benchSizes); s++) {
+        int size = benchSizes[s];
+
+        for (int v = 0; v < NUM_ITEMS(benchVacancies); v++) {
+            int vacancy = benchVacancies[v];
+
+            snprintf(name, sizeof(name), "getHappiness/d%d/v%d", size,
+                     vacancy);
+            if (!addCase(results, &numResults, filter, name, "agent",
+                         runGetHappiness, size, vacancy, 50,
+                         KERNEL_COUNTS)) {
+                return -1;
+            }
+
+            snprintf(name, sizeof(name), "moveAgent/d%d/v%d", size, vacancy);
+            if (!addCase(results, &numResults, filter, name, "move",
+                         runMoveAgent, size, vacancy, 50, KERNEL_COUNTS)) {
+                return -1;
+            }
+
+            snprintf(name, sizeof(name), "shuffle/d%d/v%d", size, vacancy);
+            if (!addCase(results, &numResults, filter, name, "cell",
+                         runShuffle, size, vacancy, 50, KERNEL_COUNTS)) {
+                return -1;
+            }
+
+            for (int k = 0; k < NUM_ITEMS(benchKernels); k++) {
+                snprintf(name, sizeof(name), "getBoardHappiness/%s/d%d/v%d",
+                         kernelNames[k], size, vacancy);
+                if (!addCase(results, &numResults, filter, name, "cell",
+                             runBoardHappiness, size, vacancy, 50,
+                             benchKernels[k])) {
+                    return -1;
+                }
+
+                for (int t = 0; t < NUM_ITEMS(benchStrengths); t++) {
+                    snprintf(name, sizeof(name), "gameMove/%s/d%d/v%d/s%d",
+                             kernelNames[k], size, vacancy,
+                             benchStrengths[t]);
+                    if (!addCase(results, &numResults, filter, name, "cell",
+                                 runGameMove, size, vacancy,
+                                 benchStrengths[t], benchKernels[k])) {
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    return numResults;
+}
+
+
+/**
+ * runPasses samples every case in each of a number of passes, so the
+ * samples of a case are spread out over the whole run rather than taken all
+ * at once, then prints the times of every case.
+ *
+ * @param results     the cases to run, filled with their samples
+ * @param numResults  the number of cases
+ * @param samples     the number of samples of each case in each pass
+ * @param passes      the number of passes
+ * @returns           1 unless memory ran out
+ */
+static int runPasses(Result results[], int numResults, int samples,
+                     int passes) {
+
+    for (int pass = 1; pass <= passes; pass++) {
+        fprintf(stderr, "microbench: pass %d of %d\n", pass, passes);
+
+        for (int r = 0; r < numResults; r++) {
+            if (!sampleCase(&results[r], samples)) {
+                fprintf(stderr, "microbench: not enough memory for %s\n",
+                        results[r].name);
+                return 0;
+            }
+        }
+    }
+
+    printf("%-36s %12s %12s %12s\n", "case", "fastest", "median", "p95");
+    for (int r = 0; r < numResults; r++) {
+        printf("%-36s %12.2f %12.2f %12.2f  ns/%s\n", results[r].name,
+               results[r].fastest, results[r].median, results[r].p95,
+               results[r].unit);
+    }
+    fflush(stdout);
+
+    return 1;
+}
+
+
+/**
+ * saveResults writes RESULTS_HEADER, then one line per case: its name, its
+ * unit, and its fastest sample, median, and 95th percentile in nanoseconds.
+ *
+ * @param path        the file to write
+ * @param results     the results to save
+ * @param numResults  the number of results
+ * @returns           1 if the file was written, 0 otherwise
+ */
+static int saveResults(const char *path, const Result results[],
+                       int numResults) {
+
+    FILE *out = fopen(path, "w");
+
+    if (out == NULL) {
+        perror(path);
+        return 0;
+    }
+
+    fputs(RESULTS_HEADER, out);
+    for (int r = 0; r < numResults; r++) {
+        fprintf(out, "%s %s %.3f %.3f %.3f\n", results[r].name,
+                results[r].unit, results[r].fastest, results[r].median,
+                results[r].p95);
+    }
+
+    if (fclose(out) != 0) {
+        perror(path);
+        return 0;
+    }
+    return 1;
+}
+
+
+/**
+ * slowerThan checks a case against its saved fastest sample: it is slower
+ * if its own fastest sample is above the saved one grown by the threshold.
+ *
+ * @param result     the case as run now
+ * @param fastest    the saved fastest sample
+ * @param threshold  the percent the fastest sample may grow by
+ * @returns          1 if the case is slower, 0 otherwise
+ */
+static int slowerThan(const Result *result, double fastest,
+                      double threshold) {
+
+    return result->fastest > fastest * (1 + threshold / 100);
+}
+
+
+/**
+ * compareResults compares every case run with the same case in a file saved
+ * by saveResults, printing the change in its fastest sample. The cases that
+ * are slower are sampled in CONFIRM_PASSES more passes once every case has
+ * been compared, and only count as regressions if the fastest of all their
+ * samples is still slower. Cases missing from either side are reported but
+ * are not failures.
+ *
+ * @param path        the file saved before
+ * @param results     the results of this run, which gain the samples of
+ *                    the cases sampled again
+ * @param numResults  the number of results
+ * @param threshold   the percent a fastest sample may grow by
+ * @param samples     the number of samples of a case in each pass
+ * @returns           the number of cases still slower, or -1 if the file
+ *                    couldn't be read or memory ran out
+ */
+static int compareResults(const char *path, Result results[], int numResults,
+                          double threshold, int samples) {
+
+    FILE *in = fopen(path, "r");
+    char line[RESULT_LINE_SIZE];
+    char name[CASE_NAME_SIZE];
+    int found[MAX_CASES] = {0};
+    int slower[MAX_CASES] = {0};  // Boolean, true while the case is slower
+    int sampledAgain[MAX_CASES] = {0};  // Boolean, true if it was confirmed
+    double savedFastest[MAX_CASES];
+    int regressions = 0;
+
+    if (in == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    // Files from before the fastest sample was saved hold other times in
+    // the same columns
+    if (fgets(line, sizeof(line), in) == NULL ||
+        strcmp(line, RESULTS_HEADER) != 0) {
+        fprintf(stderr, "microbench: %s wasn't saved by this version of "
+                        "microbench, save it again\n", path);
+        fclose(in);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        double fastest;
+
+        if (line[0] == '#' || sscanf(line, "%63s %*s %lf", name,
+                                     &fastest) != 2) {
+            continue;
+        }
+
+        for (int r = 0; r < numResults; r++) {
+            if (strcmp(results[r].name, name) == 0) {
+                found[r] = 1;
+                savedFastest[r] = fastest;
+                slower[r] = slowerThan(&results[r], fastest, threshold);
+            }
+        }
+    }
+    fclose(in);
+
+    for (int pass = 1; pass <= CONFIRM_PASSES; pass++) {
+        for (int r = 0; r < numResults; r++) {
+            if (!slower[r]) {
+                continue;
+            }
+            if (!sampleCase(&results[r], samples)) {
+                fprintf(stderr, "microbench: not enough memory for %s\n",
+                        results[r].name);
+                return -1;
+            }
+            sampledAgain[r] = 1;
+            slower[r] = slowerThan(&results[r], savedFastest[r], threshold);
+        }
+    }
+
+    printf("\n%-36s %12s %12s %9s\n", "case", "baseline", "fastest",
+           "change");
+
+    for (int r = 0; r < numResults; r++) {
+        if (!found[r]) {
+            printf("%-36s %12s %12.2f\n", results[r].name, "none",
+                   results[r].fastest);
+            continue;
+        }
+
+        double change = savedFastest[r] > 0 ? (results[r].fastest -
+                                               savedFastest[r]) * 100 /
+                                              savedFastest[r] : 0.0;
+        regressions += slower[r];
+
+        printf("%-36s %12.2f %12.2f %+8.1f%%%s\n", results[r].name,
+               savedFastest[r], results[r].fastest, change,
+               slower[r] ? "  REGRESSED" :
+               sampledAgain[r] ? "  (noise, fine once sampled more)" : "");
+    }
+
+    printf("%d of %d cases slower than %s by more than %.1f%%\n",
+           regressions, numResults, path, threshold);
+    return regressions;
+}
+
+
+/**
+ * main reads the flags, runs the cases, and saves or compares the results.
+ *
+ * @param argc  the number of arguments
+ * @param argv  the arguments
+ * @returns     EXIT_SUCCESS, or EXIT_FAILURE if a flag was invalid, memory
+ *              ran out, a file couldn't be used, or a case regressed, or
+ *              with -a, if any case didn't
+ */
+int main(int argc, char *argv[]) {
+
+    int samples = DEFAULT_SAMPLES;
+    int passes = DEFAULT_PASSES;
+    double threshold = DEFAULT_THRESHOLD;
+    const char *filter = NULL;
+    const char *savePath = NULL;
+    const char *comparePath = NULL;
+    int expectAll = 0;  // Boolean, true if every case must regress
+    static Result results[MAX_CASES];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "hr:n:f:o:c:t:a")) != -1) {
+        switch (opt) {
+
+        case 'h':
+            printUsage(stdout);
+            return EXIT_SUCCESS;
+
+        case 'r':
+            samples = atoi(optarg);
+            if (samples < 1 || samples > MAX_SAMPLES) {
+                fprintf(stderr, "microbench: samples must be from 1 to "
+                                "%d\n", MAX_SAMPLES);
+                return EXIT_FAILURE;
+            }
+            break;
+
+        case 'n':
+            passes = atoi(optarg);
+            if (passes < 1 || passes > MAX_PASSES) {
+                fprintf(stderr, "microbench: passes must be from 1 to "
+                                "%d\n", MAX_PASSES);
+                return EXIT_FAILURE;
+            }
+            break;
+
+        case 'f':
+            filter = optarg;
+            break;
+
+        case 'o':
+            savePath = optarg;
+            break;
+
+        case 'c':
+            comparePath = optarg;
+            break;
+
+        case 't':
+            threshold = atof(optarg);
+            if (threshold < 0) {
+                fprintf(stderr, "microbench: threshold must not be "
+                                "negative\n");
+                return EXIT_FAILURE;
+            }
+            break;
+
+        case 'a':
+            expectAll = 1;
+            break;
+
+        default:
+            printUsage(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (expectAll && comparePath == NULL) {
+        fprintf(stderr, "microbench: -a needs -c\n");
+        return EXIT_FAILURE;
+    }
+
+    int numResults = listCases(results, filter);
+
+    if (numResults < 0 || !runPasses(results, numResults, samples, passes)) {
+        return EXIT_FAILURE;
+    }
+    // Save first, so the cases sampled again don't change what is saved
+    if (savePath != NULL && !saveResults(savePath, results, numResults)) {
+        return EXIT_FAILURE;
+    }
+    if (comparePath == NULL) {
+        return EXIT_SUCCESS;
+    }
+
+    int regressions = compareResults(comparePath, results, numResults,
+                                     threshold, samples);
+
+    if (regressions < 0) {
+        return EXIT_FAILURE;
+    }
+    if (expectAll) {
+        return regressions == numResults && numResults > 0 ?
+               EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    return regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
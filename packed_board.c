@@ -0,0 +1,317 @@
+//
+// File: packed_board.c
+// Description: Contains the functions for the packed bitplane board. A row's
+// neighbor counts are kept as four bit-sliced counter words per 64 cells, so
+// adding one shifted neighbor row to all 64 counters at once only takes a
+// few AND and XOR operations. On x86 the adds are also compiled for AVX2,
+// which does them 256 cells at a time, and that version is used whenever
+// the CPU running the program has it.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include <stdlib.h>
+#include <string.h>
+
+// Builds the AVX2 adds alongside the plain ones, for compilers that can
+// target AVX2 in one function without it being on for the whole file
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PACKED_AVX2
+#include <immintrin.h>
+#endif
+
+#include "packed_board.h"
+
+
+/**
+ * initPackedBoard(): Allocates the planes, then sets the bits of every cell
+ * from the board.
+ */
+int initPackedBoard(PackedBoard *packed, int dimensions,
+                    char board[dimensions][dimensions], int numTypes,
+                    int torus) {
+
+    size_t wordsPerRow = ((size_t)dimensions + 63) / 64;
+    size_t planeWords = wordsPerRow * dimensions;
+
+    packed->dimensions = dimensions;
+    packed->numTypes = numTypes;
+    packed->torus = torus;
+    packed->wordsPerRow = wordsPerRow;
+    packed->planeWords = planeWords;
+    packed->occupied = calloc(planeWords, sizeof(uint64_t));
+    packed->types = calloc(planeWords * (numTypes - 1), sizeof(uint64_t));
+
+    if (packed->occupied == NULL || packed->types == NULL) {
+        freePackedBoard(packed);
+        return 0;
+    }
+
+    for (int i = 0; i < dimensions; i++) {
+        for (int j = 0; j < dimensions; j++) {
+            packedSetCell(packed, i, j, board[i][j]);
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * freePackedBoard(): Frees the planes.
+ */
+void freePackedBoard(PackedBoard *packed) {
+
+    free(packed->occupied);
+    free(packed->types);
+
+    packed->occupied = NULL;
+    packed->types = NULL;
+}
+
+
+/**
+ * packedSetCell(): Sets or clears the cell's bit in each plane.
+ */
+void packedSetCell(PackedBoard *packed, int row, int col, char agent) {
+
+    size_t word = row * packed->wordsPerRow + col / 64;
+    uint64_t bit = (uint64_t)1 << (col % 64);
+    int type = AGENT_TYPE(agent);
+
+    if (type < 0) {
+        packed->occupied[word] &= ~bit;
+    }
+    else {
+        packed->occupied[word] |= bit;
+    }
+
+    for (int k = 0; k < packed->numTypes - 1; k++) {
+        if (k == type) {
+            packed->types[k * packed->planeWords + word] |= bit;
+        }
+        else {
+            packed->types[k * packed->planeWords + word] &= ~bit;
+        }
+    }
+}
+
+
+#ifdef PACKED_AVX2
+/**
+ * addPlaneAvx2(): Adds a row of one-bit values to the four bit-sliced
+ * counters the same way addPlane does, but 256 cells at a time, for as many
+ * whole groups of four words as the row has. Returns the words it added, and
+ * must only be called when the CPU has AVX2.
+ */
+__attribute__((target("avx2")))
+static size_t addPlaneAvx2(uint64_t *counters, const uint64_t *bits,
+                           size_t words) {
+
+    uint64_t *c0 = counters;
+    uint64_t *c1 = counters + words;
+    uint64_t *c2 = counters + 2 * words;
+    uint64_t *c3 = counters + 3 * words;
+    size_t w = 0;
+
+    for (; w + 4 <= words; w += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(bits + w));
+        __m256i b0 = _mm256_loadu_si256((__m256i *)(c0 + w));
+        __m256i b1 = _mm256_loadu_si256((__m256i *)(c1 + w));
+        __m256i b2 = _mm256_loadu_si256((__m256i *)(c2 + w));
+        __m256i b3 = _mm256_loadu_si256((__m256i *)(c3 + w));
+
+        __m256i carry = _mm256_and_si256(b0, x);
+        b0 = _mm256_xor_si256(b0, x);
+        x = carry;
+        carry = _mm256_and_si256(b1, x);
+        b1 = _mm256_xor_si256(b1, x);
+        x = carry;
+        carry = _mm256_and_si256(b2, x);
+        b2 = _mm256_xor_si256(b2, x);
+        b3 = _mm256_or_si256(b3, carry);
+
+        _mm256_storeu_si256((__m256i *)(c0 + w), b0);
+        _mm256_storeu_si256((__m256i *)(c1 + w), b1);
+        _mm256_storeu_si256((__m256i *)(c2 + w), b2);
+        _mm256_storeu_si256((__m256i *)(c3 + w), b3);
+    }
+
+    return w;
+}
+#endif
+
+
+/**
+ * addPlane(): Adds a row of one-bit values to the four bit-sliced counters
+ * of every cell, rippling the carry up through the counter bits. The words
+ * AVX2 can take are handed to addPlaneAvx2 if the CPU has it, which libgcc
+ * finds out once at startup, so checking costs a load.
+ */
+static void addPlane(uint64_t *counters, const uint64_t *bits, size_t words) {
+
+    uint64_t *c0 = counters;
+    uint64_t *c1 = counters + words;
+    uint64_t *c2 = counters + 2 * words;
+    uint64_t *c3 = counters + 3 * words;
+    size_t w = 0;
+
+#ifdef PACKED_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        w = addPlaneAvx2(counters, bits, words);
+    }
+#endif
+
+    // Add 64 cells at a time
+    for (; w < words; w++) {
+        uint64_t x = bits[w];
+        uint64_t carry;
+
+        carry = c0[w] & x;
+        c0[w] ^= x;
+        x = carry;
+        carry = c1[w] & x;
+        c1[w] ^= x;
+        x = carry;
+        carry = c2[w] & x;
+        c2[w] ^= x;
+        c3[w] |= carry;  // At most 8 neighbors, so bit 3 never carries
+    }
+}
+
+
+/**
+ * countPlane(): Adds up the set bits around every cell of a row in one
+ * plane. The rows above and below add their cell straight on plus the cells
+ * shifted in from either side, and the row itself only adds the sides. The
+ * bits past the last column are always clear, so a bounded board shifts in
+ * nothing at the edges, and a torus puts the other end's bit there instead.
+ */
+static void countPlane(const PackedBoard *packed, const uint64_t *plane,
+                       int row, uint64_t *scratch, uint64_t *counters) {
+
+    int dimensions = packed->dimensions;
+    size_t words = packed->wordsPerRow;
+    uint64_t *west = scratch;          // bit j is the cell at j - 1
+    uint64_t *east = scratch + words;  // bit j is the cell at j + 1
+    size_t lastWord = (dimensions - 1) / 64;  // Word and bit of the last
+    int lastBit = (dimensions - 1) % 64;      // column
+
+    memset(counters, 0, 4 * words * sizeof(uint64_t));
+
+    for (int di = -1; di <= 1; di++) {
+        int i = row + di;
+
+        // Wrap rows off the top or bottom of a torus, and skip them
+        // otherwise
+        if (i < 0 || i >= dimensions) {
+            if (!packed->torus) {
+                continue;
+            }
+            i = i < 0 ? dimensions - 1 : 0;
+        }
+
+        const uint64_t *bits = plane + i * words;
+
+        // Shift the row one cell each way, carrying bits across words
+        for (size_t w = 0; w < words; w++) {
+            west[w] = (bits[w] << 1) | (w > 0 ? bits[w - 1] >> 63 : 0);
+            east[w] = (bits[w] >> 1) |
+                      (w + 1 < words ? bits[w + 1] << 63 : 0);
+        }
+
+        // Carry the bit at each end around to the other
+        if (packed->torus) {
+            west[0] |= (bits[lastWord] >> lastBit) & 1;
+            east[lastWord] |= (bits[0] & 1) << lastBit;
+        }
+
+        // The cell itself is not one of its neighbors
+        if (di != 0) {
+            addPlane(counters, bits, words);
+        }
+        addPlane(counters, west, words);
+        addPlane(counters, east, words);
+    }
+}
+
+
+/**
+ * countRowTyped(): Counts the occupied neighbors and the neighbors of every
+ * type with a plane across the whole row, then reads each cell's counters
+ * back out. A cell in a type's plane is the same as its neighbors of that
+ * type, and a cell of the last type as the occupied neighbors in no plane.
+ */
+TYPED_KERNEL void countRowTyped(const PackedBoard *packed, int row,
+                                uint64_t *scratch, uint16_t *same,
+                                uint16_t *total, int numTypes) {
+
+    size_t words = packed->wordsPerRow;
+    size_t rowStart = row * words;
+    uint64_t *occupiedCount = scratch + 2 * words;
+    uint64_t *typeCount = scratch + 6 * words;  // 4 words per 64 cells each
+    const uint64_t *occupied = packed->occupied + rowStart;
+
+    countPlane(packed, packed->occupied, row, scratch, occupiedCount);
+    for (int k = 0; k < numTypes - 1; k++) {
+        countPlane(packed, packed->types + k * packed->planeWords, row,
+                   scratch, typeCount + 4 * k * words);
+    }
+
+    for (int j = 0; j < packed->dimensions; j++) {
+        size_t w = j / 64;
+        int b = j % 64;
+        int numOccupied = 0;
+
+        // Put the four counter bits of the cell back together
+        for (int c = 3; c >= 0; c--) {
+            numOccupied = (numOccupied << 1) |
+                          (int)((occupiedCount[c * words + w] >> b) & 1);
+        }
+
+        total[j] = numOccupied;
+
+        if (!((occupied[w] >> b) & 1)) {
+            same[j] = 0;
+            continue;
+        }
+
+        // A cell in a type's plane takes that type's count, and a cell in
+        // none of them keeps what is left once every plane's count is taken
+        int numSame = numOccupied;
+
+        for (int k = 0; k < numTypes - 1; k++) {
+            const uint64_t *counters = typeCount + 4 * k * words;
+            const uint64_t *plane = packed->types + k * packed->planeWords +
+                                    rowStart;
+            int count = 0;
+
+            for (int c = 3; c >= 0; c--) {
+                count = (count << 1) | (int)((counters[c * words + w] >> b) &
+                                             1);
+            }
+
+            if ((plane[w] >> b) & 1) {
+                numSame = count;
+                break;
+            }
+            numSame -= count;
+        }
+
+        same[j] = numSame;
+    }
+}
+
+
+/**
+ * packedCountRow(): Counts the row with the copy of the kernel for the
+ * board's number of types.
+ */
+void packedCountRow(const PackedBoard *packed, int row, uint64_t *scratch,
+                    uint16_t *same, uint16_t *total) {
+
+    BY_TYPES(packed->numTypes, countRowTyped, packed, row, scratch, same,
+             total);
+}
@@ -0,0 +1,102 @@
+//
+// File: packed_board.h
+// Description: Provides a packed copy of the board made of bitplanes, one
+// with a bit set for every non-vacant cell and one for each type of agent but
+// the last with a bit set for every cell of that type, which for two types
+// is just the endline cells. The neighbor counts for a whole row are found
+// 64 cells at a time by shifting the planes of the rows above, on, and below
+// it and adding the shifted words together with bitwise full adders. On a
+// torus the rows and the bits shifted off either end wrap around.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for packed_board.h
+#ifndef _PACKED_BOARD_H_
+#define _PACKED_BOARD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "agent_types.h"
+
+
+/**
+ * PackedBoard holds the bitplanes of a board. Bit j of word j / 64 in a row
+ * stands for column j, and every row starts on a new word. The last type
+ * has no plane of its own, since its cells are the occupied ones that are
+ * in no other type's plane.
+ */
+typedef struct {
+    int dimensions;        // the size of the square board
+    int numTypes;          // types of agents in the board
+    int torus;             // boolean, true if the board wraps around
+    size_t wordsPerRow;    // words used by each row of a plane
+    size_t planeWords;     // words used by each plane
+    uint64_t *occupied;    // bit set for every non-vacant cell
+    uint64_t *types;       // plane of each type but the last, one after
+                           // another, with a bit set for every cell of it
+} PackedBoard;
+
+
+// Words of scratch space packedCountRow needs: two shifted rows plus four
+// counter words for the occupied plane and each type's plane
+#define PACKED_SCRATCH_WORDS(packed) \
+    ((2 + 4 * (size_t)(packed)->numTypes) * (packed)->wordsPerRow)
+
+
+/**
+ * initPackedBoard allocates the bitplanes for a board and fills them in.
+ *
+ * @param packed      the packed board to initialize
+ * @param dimensions  the size of the square 2D array given
+ * @param board       a 2D array of chars to pack
+ * @param numTypes    the number of types of agents, from 2 to MAX_TYPES
+ * @param torus       1 if the board wraps around, 0 if it stops at the edges
+ * @returns           1 if the planes were set up, 0 if memory ran out
+ */
+int initPackedBoard(PackedBoard *packed, int dimensions,
+                    char board[dimensions][dimensions], int numTypes,
+                    int torus);
+
+
+/**
+ * freePackedBoard releases the memory held by the bitplanes.
+ *
+ * @param packed  the packed board to free
+ */
+void freePackedBoard(PackedBoard *packed);
+
+
+/**
+ * packedSetCell updates the bits of one cell to match a char.
+ *
+ * @param packed  the packed board to update
+ * @param row     the row of the cell
+ * @param col     the column of the cell
+ * @param agent   the char now in the cell, '.' or an agent
+ */
+void packedSetCell(PackedBoard *packed, int row, int col, char agent);
+
+
+/**
+ * packedCountRow finds the number of non-vacant neighbors of every cell in a
+ * row, and how many of them are the same type as the cell. It only reads the
+ * planes, so different rows can be counted at the same time as long as each
+ * uses its own scratch space.
+ *
+ * @param packed   the packed board to count in
+ * @param row      the row to count
+ * @param scratch  PACKED_SCRATCH_WORDS(packed) words of scratch space
+ * @param same     filled with the same-type neighbors of each cell in the row
+ * @param total    filled with the non-vacant neighbors of each cell in the
+ *                 row
+ */
+void packedCountRow(const PackedBoard *packed, int row, uint64_t *scratch,
+                    uint16_t *same, uint16_t *total);
+
+
+// End include guard
+#endif
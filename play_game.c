@@ -11,6 +11,764 @@
 
 #include "play_game.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+
+/**
+ * agentHash(): Mixes the cell and the agent in it into 64 random-looking
+ * bits. The board's hash is the XOR of this over every agent, so a move only
+ * has to XOR out the old cell and XOR in the new one.
+ */
+uint64_t agentHash(size_t cell, char agent) {
+
+    uint64_t z = (uint64_t)cell * 256 + (unsigned char)agent;
+
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    return z ^ (z >> 31);
+}
+
+
+/**
+ * sameNeighborsTyped(): Gives the kept count of a cell's neighbors of the
+ * given type. Every type but the last has a plane of counts, and the last
+ * type's neighbors are the occupied ones counted in none of them.
+ */
+TYPED_KERNEL int sameNeighborsTyped(const Game *game, size_t cell, int type,
+                                    int numTypes) {
+
+    size_t totalSpaces = (size_t)game->dimensions * game->dimensions;
+
+    if (type < numTypes - 1) {
+        return game->typeNeighbors[type * totalSpaces + cell];
+    }
+
+    int same = game->totalNeighbors[cell];
+    for (int k = 0; k < numTypes - 1; k++) {
+        same -= game->typeNeighbors[k * totalSpaces + cell];
+    }
+
+    return same;
+}
+
+
+/**
+ * tallyAgent(): Adds an agent to, or takes one away from, the game's count of
+ * agents of its type with each pair of neighbor counts, using the counts of
+ * its cell.
+ */
+static void tallyAgent(Game *game, size_t cell, char agent, int delta) {
+
+    int type = AGENT_TYPE(agent);
+    int total = game->totalNeighbors[cell];
+    int same = BY_TYPES(game->numTypes, sameNeighborsTyped, game, cell, type);
+
+    game->pairs[type][total][same] += delta;
+}
+
+
+/**
+ * changeNeighbors(): Adds an agent to, or takes one away from, the counts of
+ * the up to 8 cells around it, which wrap around the edges of a torus. When
+ * the board is given, each agent around the cell is also moved to the tally
+ * of its new counts, so the board must match the counts as they were before
+ * the change.
+ */
+static void changeNeighbors(Game *game, int dimensions, const char *board,
+                            size_t cell, char agent, int delta) {
+
+    int row = cell / dimensions;
+    int col = cell % dimensions;
+    int type = AGENT_TYPE(agent);
+    size_t totalSpaces = (size_t)dimensions * dimensions;
+
+    for (int di = -1; di <= 1; di++) {
+        int i = game->wrap[row + di + 1];
+
+        // Skip rows off the top or bottom of a bounded board
+        if (i < 0) {
+            continue;
+        }
+
+        for (int dj = -1; dj <= 1; dj++) {
+            int j = game->wrap[col + dj + 1];
+
+            // Skip columns off a bounded board and the cell itself
+            if (j < 0 || (di == 0 && dj == 0)) {
+                continue;
+            }
+
+            size_t neighbor = (size_t)i * dimensions + j;
+            int neighborType = board != NULL ? AGENT_TYPE(board[neighbor]) :
+                                               -1;
+
+            // Only the neighbor's total changes, and its same-type count if
+            // the agent is its type, so it moves straight to its new pair
+            if (neighborType >= 0) {
+                int total = game->totalNeighbors[neighbor];
+                int same = BY_TYPES(game->numTypes, sameNeighborsTyped, game,
+                                    neighbor, neighborType);
+                size_t (*pairs)[9] = game->pairs[neighborType];
+
+                pairs[total][same]--;
+                pairs[total + delta][same +
+                                     (neighborType == type ? delta : 0)]++;
+            }
+
+            game->totalNeighbors[neighbor] += delta;
+            if (type < game->numTypes - 1) {
+                game->typeNeighbors[type * totalSpaces + neighbor] += delta;
+            }
+        }
+    }
+}
+
+
+/**
+ * haloSetCell(): Puts a char in the cell's spot in the copy of the board
+ * inside the ghost cells.
+ */
+static void haloSetCell(Game *game, size_t cell, char agent) {
+
+    int dimensions = game->dimensions;
+    size_t width = (size_t)dimensions + 2;
+
+    game->halo[(cell / dimensions + 1) * width + cell % dimensions + 1] =
+        agent;
+}
+
+
+/**
+ * refreshHalo(): Copies each edge of a torus into the ghost cells on the
+ * other side of the board, corners included, once the columns are done. The
+ * ghost cells of a bounded board are always vacant.
+ */
+static void refreshHalo(Game *game) {
+
+    int dimensions = game->dimensions;
+    size_t width = (size_t)dimensions + 2;
+    char *halo = game->halo;
+
+    if (!game->torus) {
+        return;
+    }
+
+    for (int i = 1; i <= dimensions; i++) {
+        halo[i * width] = halo[i * width + dimensions];
+        halo[i * width + dimensions + 1] = halo[i * width + 1];
+    }
+    memcpy(halo, halo + dimensions * width, width);
+    memcpy(halo + (dimensions + 1) * width, halo + width, width);
+}
+
+
+static void *findUnhappy(void *arg);
+
+
+/**
+ * bandWorker(): Waits for the bands to be ready, checks its own band, and
+ * reports it checked, over and over until the game is freed.
+ */
+static void *bandWorker(void *arg) {
+
+    Band *band = arg;
+    Game *game = band->game;
+    unsigned long round = 0;  // The last round this worker checked
+
+    pthread_mutex_lock(&game->poolLock);
+    for (;;) {
+        while (game->poolRound == round && !game->poolStop) {
+            pthread_cond_wait(&game->poolStart, &game->poolLock);
+        }
+        if (game->poolStop) {
+            break;
+        }
+        round = game->poolRound;
+        pthread_mutex_unlock(&game->poolLock);
+
+        findUnhappy(band);
+
+        pthread_mutex_lock(&game->poolLock);
+        if (--game->poolPending == 0) {
+            pthread_cond_signal(&game->poolDone);
+        }
+    }
+    pthread_mutex_unlock(&game->poolLock);
+
+    return NULL;
+}
+
+
+/**
+ * startWorkers(): Sets up the lock and conditions the workers wait on and
+ * starts a worker for every band but the first. A band whose worker can't
+ * be started is checked by checkBands on its own thread instead.
+ */
+static void startWorkers(Game *game) {
+
+    pthread_mutex_init(&game->poolLock, NULL);
+    pthread_cond_init(&game->poolStart, NULL);
+    pthread_cond_init(&game->poolDone, NULL);
+    game->poolRound = 0;
+    game->poolPending = 0;
+    game->poolStop = 0;
+    game->poolReady = 1;
+
+    for (int t = 1; t < game->threads; t++) {
+        Band *band = &game->bands[t];
+        band->running = pthread_create(&band->thread, NULL, bandWorker,
+                                       band) == 0;
+    }
+}
+
+
+/**
+ * stopWorkers(): Tells the workers to exit, waits for them, and frees the
+ * lock and conditions, if they were started.
+ */
+static void stopWorkers(Game *game) {
+
+    if (!game->poolReady) {
+        return;
+    }
+
+    pthread_mutex_lock(&game->poolLock);
+    game->poolStop = 1;
+    pthread_cond_broadcast(&game->poolStart);
+    pthread_mutex_unlock(&game->poolLock);
+
+    for (int t = 1; t < game->threads; t++) {
+        if (game->bands[t].running) {
+            pthread_join(game->bands[t].thread, NULL);
+            game->bands[t].running = 0;
+        }
+    }
+
+    pthread_cond_destroy(&game->poolDone);
+    pthread_cond_destroy(&game->poolStart);
+    pthread_mutex_destroy(&game->poolLock);
+    game->poolReady = 0;
+}
+
+
+/**
+ * initGame(): Allocates the vacancy index, move lists, bands, and whatever
+ * the kernel counts neighbors from, then fills them in from the board, and
+ * starts the band workers once nothing else can fail.
+ */
+int initGame(Game *game, int dimensions, char board[dimensions][dimensions],
+             int numTypes, int radius, int torus, Kernel kernel,
+             int threads) {
+
+    size_t totalSpaces = (size_t)dimensions * dimensions;
+    size_t numVacant = 0;  // Counts the vacant chars, the most moves a cycle
+
+    // Every band needs at least one row
+    if (threads > dimensions) {
+        threads = dimensions;
+    }
+
+    game->dimensions = dimensions;
+    game->numTypes = numTypes;
+    game->radius = radius;
+    game->torus = torus;
+    game->kernel = kernel;
+    game->threads = threads;
+    game->bands = calloc(threads, sizeof(Band));
+    game->typeNeighbors = NULL;
+    game->totalNeighbors = NULL;
+    game->packed.occupied = NULL;
+    game->packed.types = NULL;
+    game->halo = NULL;
+    game->wrap = malloc((dimensions + 2) * sizeof(int));
+    game->moveFrom = NULL;
+    game->moveTo = NULL;
+    game->moveAgent = NULL;
+    game->numMoves = 0;
+    game->hash = 0;
+    initCounters(&game->counters, 0);
+    memset(game->pairs, 0, sizeof(game->pairs));
+    game->unhappyThreshold = -1;
+    game->vacancies.levels = 0;
+    memset(&game->vacancyIndex, 0, sizeof(game->vacancyIndex));
+    game->unhappy.levels = 0;
+    game->dirty.levels = 0;
+    game->update = UPDATE_SYNC;
+    memset(&game->worklist, 0, sizeof(game->worklist));
+    game->rng = NULL;
+    game->poolReady = 0;
+
+    if (game->bands == NULL || game->wrap == NULL ||
+        !initCellSet(&game->vacancies, totalSpaces)) {
+        freeGame(game);
+        return 0;
+    }
+
+    // The rows and columns just off each edge are the ones on the other
+    // side of a torus, and not on a bounded board at all
+    for (int i = 0; i < dimensions; i++) {
+        game->wrap[i + 1] = i;
+    }
+    game->wrap[0] = torus ? dimensions - 1 : -1;
+    game->wrap[dimensions + 1] = torus ? 0 : -1;
+
+    // Only the counts kernel keeps every cell's counts between cycles, and
+    // the agents they make unhappy
+    if (kernel == KERNEL_COUNTS) {
+        game->typeNeighbors = calloc(totalSpaces * (numTypes - 1), 1);
+        game->totalNeighbors = calloc(totalSpaces, 1);
+
+        if (game->typeNeighbors == NULL || game->totalNeighbors == NULL ||
+            !initCellSet(&game->unhappy, totalSpaces) ||
+            !initCellSet(&game->dirty, totalSpaces)) {
+            freeGame(game);
+            return 0;
+        }
+    }
+    else if (kernel == KERNEL_PACKED &&
+             !initPackedBoard(&game->packed, dimensions, board, numTypes,
+                              torus)) {
+        freeGame(game);
+        return 0;
+    }
+    else if (kernel == KERNEL_CHAR) {
+        size_t width = (size_t)dimensions + 2;
+        game->halo = malloc(width * width);
+
+        if (game->halo == NULL) {
+            freeGame(game);
+            return 0;
+        }
+
+        memset(game->halo, '.', width * width);
+        for (int i = 0; i < dimensions; i++) {
+            memcpy(game->halo + (i + 1) * width + 1, board[i], dimensions);
+        }
+        refreshHalo(game);
+    }
+
+    // Split the rows as evenly as possible between the bands
+    for (int t = 0; t < threads; t++) {
+        Band *band = &game->bands[t];
+        band->game = game;
+        band->firstRow = (int)((long)dimensions * t / threads);
+        band->endRow = (int)((long)dimensions * (t + 1) / threads);
+
+        size_t bandSpaces = (size_t)(band->endRow - band->firstRow) *
+                            dimensions;
+        band->unhappy = malloc((bandSpaces + 63) / 64 * sizeof(uint64_t));
+        band->rowSame = malloc(dimensions * sizeof(uint16_t));
+        band->rowTotal = malloc(dimensions * sizeof(uint16_t));
+
+        if (kernel == KERNEL_PACKED) {
+            band->scratch = malloc(PACKED_SCRATCH_WORDS(&game->packed) *
+                                   sizeof(uint64_t));
+        }
+
+        if (band->unhappy == NULL || band->rowSame == NULL ||
+            band->rowTotal == NULL ||
+            (kernel == KERNEL_PACKED && band->scratch == NULL) ||
+            (kernel == KERNEL_BOX &&
+             !initBoxFilter(&band->box, dimensions, radius, numTypes,
+                            torus))) {
+            freeGame(game);
+            return 0;
+        }
+    }
+
+    // Count the neighbors of every cell and index the vacant ones
+    for (int i = 0; i < dimensions; i++) {
+        for (int j = 0; j < dimensions; j++) {
+            size_t cell = (size_t)i * dimensions + j;
+
+            if (board[i][j] != '.') {
+                game->hash ^= agentHash(cell, board[i][j]);
+            }
+
+            if (kernel == KERNEL_COUNTS && board[i][j] != '.') {
+                changeNeighbors(game, dimensions, NULL, cell, board[i][j], 1);
+            }
+
+            if (board[i][j] == '.') {
+                cellSetInsert(&game->vacancies, cell);
+                numVacant++;
+            }
+        }
+    }
+
+    // Tally every agent once all of the counts are known
+    if (kernel == KERNEL_COUNTS) {
+        for (size_t cell = 0; cell < totalSpaces; cell++) {
+            char agent = ((char *)board)[cell];
+
+            if (agent != '.') {
+                tallyAgent(game, cell, agent, 1);
+            }
+        }
+    }
+
+    game->numAgents = totalSpaces - numVacant;
+    game->moveFrom = malloc((numVacant + 1) * sizeof(size_t));
+    game->moveTo = malloc((numVacant + 1) * sizeof(size_t));
+    game->moveAgent = malloc(numVacant + 1);
+
+    if (game->moveFrom == NULL || game->moveTo == NULL ||
+        game->moveAgent == NULL) {
+        freeGame(game);
+        return 0;
+    }
+
+    startWorkers(game);
+    return 1;
+}
+
+
+/**
+ * scoreVacancy(): Gives the best policy the neighbor counts of a cell whose
+ * counts may have changed, if it is vacant.
+ */
+static void scoreVacancy(Game *game, size_t cell) {
+
+    if (game->vacancyIndex.policy != POLICY_BEST ||
+        !cellSetContains(&game->vacancies, cell)) {
+        return;
+    }
+
+    int same[MAX_TYPES];  // Neighbors of each type around the cell
+    for (int k = 0; k < game->numTypes; k++) {
+        same[k] = BY_TYPES(game->numTypes, sameNeighborsTyped, game, cell, k);
+    }
+
+    vacancyScore(&game->vacancyIndex, cell, same, game->totalNeighbors[cell]);
+}
+
+
+/**
+ * setMovePolicy(): Replaces the index of the old policy with one for the new
+ * policy, scoring every vacant cell if it is the best policy.
+ */
+int setMovePolicy(Game *game, MovePolicy policy, Rng *rng) {
+
+    freeVacancyIndex(&game->vacancyIndex);
+
+    if (!initVacancyIndex(&game->vacancyIndex, policy, game->dimensions,
+                          game->torus, game->numTypes, &game->vacancies,
+                          rng)) {
+        return 0;
+    }
+
+    for (long cell = cellSetFirst(&game->vacancies); cell >= 0;
+         cell = cellSetNext(&game->vacancies, cell + 1)) {
+        scoreVacancy(game, cell);
+    }
+
+    return 1;
+}
+
+
+/**
+ * setUpdateMode(): Sets up the list of unhappy agents for the async update,
+ * or frees it for the sync update, and makes room in the move lists for a
+ * move by every agent.
+ */
+int setUpdateMode(Game *game, UpdateMode mode, Rng *rng) {
+
+    size_t totalSpaces = (size_t)game->dimensions * game->dimensions;
+    size_t numVacant = totalSpaces - game->numAgents;
+    size_t room = (game->numAgents > numVacant ? game->numAgents :
+                   numVacant) + 1;  // Enough moves for either update
+
+    freeWorkList(&game->worklist);
+    game->update = mode;
+    game->rng = rng;
+
+    if (mode == UPDATE_ASYNC) {
+        size_t *moveFrom = realloc(game->moveFrom, room * sizeof(size_t));
+        if (moveFrom != NULL) {
+            game->moveFrom = moveFrom;
+        }
+        size_t *moveTo = realloc(game->moveTo, room * sizeof(size_t));
+        if (moveTo != NULL) {
+            game->moveTo = moveTo;
+        }
+        char *moveAgent = realloc(game->moveAgent, room);
+        if (moveAgent != NULL) {
+            game->moveAgent = moveAgent;
+        }
+
+        if (moveFrom == NULL || moveTo == NULL || moveAgent == NULL ||
+            !initWorkList(&game->worklist, totalSpaces)) {
+            game->update = UPDATE_SYNC;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * freeGame(): Frees everything allocated by initGame.
+ */
+void freeGame(Game *game) {
+
+    stopWorkers(game);
+
+    if (game->bands != NULL) {
+        for (int t = 0; t < game->threads; t++) {
+            free(game->bands[t].unhappy);
+            free(game->bands[t].rowSame);
+            free(game->bands[t].rowTotal);
+            free(game->bands[t].scratch);
+            freeBoxFilter(&game->bands[t].box);
+        }
+    }
+
+    free(game->bands);
+    free(game->typeNeighbors);
+    free(game->totalNeighbors);
+    free(game->halo);
+    free(game->wrap);
+    free(game->moveFrom);
+    free(game->moveTo);
+    free(game->moveAgent);
+    freePackedBoard(&game->packed);
+    freeCellSet(&game->vacancies);
+    freeVacancyIndex(&game->vacancyIndex);
+    freeCellSet(&game->unhappy);
+    freeCellSet(&game->dirty);
+    freeWorkList(&game->worklist);
+
+    game->bands = NULL;
+    game->typeNeighbors = NULL;
+    game->totalNeighbors = NULL;
+    game->halo = NULL;
+    game->wrap = NULL;
+    game->moveFrom = NULL;
+    game->moveTo = NULL;
+    game->moveAgent = NULL;
+}
+
+
+/**
+ * countNeighbors(): Looks at the up to 8 chars around a cell, skipping the
+ * ones that would fall off the edge of the board.
+ */
+void countNeighbors(int dimensions, char board[dimensions][dimensions],
+                    int row, int col, int *same, int *total) {
+
+    char current = board[row][col];
+    *same = 0;
+    *total = 0;
+
+    for (int i = row - 1; i <= row + 1; i++) {
+
+        // Skip rows off the top or bottom of the board
+        if (i < 0 || i >= dimensions) {
+            continue;
+        }
+
+        for (int j = col - 1; j <= col + 1; j++) {
+
+            // Skip columns off the board and the cell itself
+            if (j < 0 || j >= dimensions || (i == row && j == col)) {
+                continue;
+            }
+
+            if (board[i][j] != '.') {
+                (*total)++;
+                if (board[i][j] == current) {
+                    (*same)++;
+                }
+            }
+        }
+    }
+}
+
+
+/**
+ * happinessFromCounts(): Computes the happiness exactly as getHappiness does
+ * so both give the same value for the same neighbors.
+ */
+double happinessFromCounts(int same, int total) {
+
+    double happiness = 100.0;
+    if (total > 0) {
+        happiness = (same / ((double)total)) * 100;
+    }
+
+    return happiness;
+}
+
+
+/**
+ * keptRowTyped(): Works out the same-type counts of every cell in a row from
+ * the counts kept for each type.
+ */
+TYPED_KERNEL void keptRowTyped(const Game *game, const char *rowChars,
+                               size_t rowStart, uint16_t *same,
+                               int numTypes) {
+
+    for (int j = 0; j < game->dimensions; j++) {
+        int type = AGENT_TYPE(rowChars[j]);
+
+        same[j] = type < 0 ? 0 : sameNeighborsTyped(game, rowStart + j, type,
+                                                     numTypes);
+    }
+}
+
+
+/**
+ * haloCountRow(): Compares the chars around every cell of a row in the copy
+ * of the board inside the ghost cells. Every cell there has 8 cells around
+ * it, so none of them has to be checked against the edges.
+ */
+static void haloCountRow(const Game *game, int row, uint16_t *same,
+                         uint16_t *total) {
+
+    int dimensions = game->dimensions;
+    size_t width = (size_t)dimensions + 2;
+    const char *above = game->halo + row * width + 1;
+    const char *middle = above + width;
+    const char *below = middle + width;
+
+    for (int j = 0; j < dimensions; j++) {
+        char current = middle[j];
+        char around[8] = {
+            above[j - 1], above[j], above[j + 1], middle[j - 1],
+            middle[j + 1], below[j - 1], below[j], below[j + 1]
+        };
+        int sameCount = 0;
+        int totalCount = 0;
+
+        for (int n = 0; n < 8; n++) {
+            totalCount += around[n] != '.';
+            sameCount += around[n] == current;
+        }
+
+        same[j] = current != '.' ? sameCount : 0;
+        total[j] = totalCount;
+    }
+}
+
+
+/**
+ * rowCounts(): Fills in the band's row arrays with the neighbor counts of
+ * every cell in a row, found with the game's kernel. The counts kernel copies
+ * the kept totals and works out the same-type counts from the kept counts of
+ * each type. The box kernel must be restarted before the first row of each
+ * pass over a board.
+ */
+static void rowCounts(Game *game, Band *band, int dimensions,
+                      char board[dimensions][dimensions], int row) {
+
+    uint16_t *same = band->rowSame;
+    uint16_t *total = band->rowTotal;
+
+    if (game->kernel == KERNEL_COUNTS) {
+        size_t rowStart = (size_t)row * dimensions;
+
+        for (int j = 0; j < dimensions; j++) {
+            total[j] = game->totalNeighbors[rowStart + j];
+        }
+        BY_TYPES(game->numTypes, keptRowTyped, game, board[row], rowStart,
+                 same);
+    }
+    else if (game->kernel == KERNEL_PACKED) {
+        packedCountRow(&game->packed, row, band->scratch, same, total);
+    }
+    else if (game->kernel == KERNEL_BOX) {
+        boxCountRow(&band->box, dimensions, board, row, same, total);
+    }
+    else {
+        haloCountRow(game, row, same, total);
+    }
+}
+
+
+/**
+ * tallyWide(): Adds an agent to a band's wide tally, with its happiness
+ * rounded down to HAPPINESS_FRACTION_BITS bits after the point.
+ */
+static void tallyWide(WideTally *wide, int type, int same, int total,
+                      int happiness, int strengthThreshold) {
+
+    uint64_t scaled = (uint64_t)1 << HAPPINESS_FRACTION_BITS;
+    if (total > 0) {
+        scaled = ((uint64_t)same << HAPPINESS_FRACTION_BITS) / total;
+    }
+
+    wide->typeAgents[type]++;
+    wide->typeScaled[type] += scaled;
+    wide->histogram[happiness / 10]++;
+
+    if (happiness < strengthThreshold) {
+        wide->unhappy++;
+    }
+}
+
+
+/**
+ * findUnhappy(): Checks every agent in a band of rows against the threshold
+ * and sets the band's bit for each one that is unhappy, tallying the agents
+ * by their neighbor counts along the way, or adding up their happiness when
+ * the radius makes the counts too big for the tally. Bands only read the
+ * board and counts, so they can all be checked at the same time.
+ */
+static void *findUnhappy(void *arg) {
+
+    Band *band = arg;
+    Game *game = band->game;
+    int dimensions = game->dimensions;
+    char (*board)[dimensions] = (char (*)[dimensions])band->board;
+    size_t bandSpaces = (size_t)(band->endRow - band->firstRow) * dimensions;
+    int wide = game->radius > 1;  // Boolean, true if the counts are too big
+                                  // for the tally of pairs
+
+    memset(band->unhappy, 0, (bandSpaces + 63) / 64 * sizeof(uint64_t));
+    memset(band->pairs, 0, game->numTypes * sizeof(band->pairs[0]));
+    memset(&band->wide, 0, sizeof(band->wide));
+    restartBoxFilter(&band->box);
+
+    for (int i = band->firstRow; i < band->endRow; i++) {
+
+        // Get the neighbor counts of the whole row
+        rowCounts(game, band, dimensions, board, i);
+        const uint16_t *same = band->rowSame;
+        const uint16_t *total = band->rowTotal;
+
+        size_t rowStart = (size_t)(i - band->firstRow) * dimensions;
+
+        for (int j = 0; j < dimensions; j++) {
+
+            // If non-empty find its happiness
+            if (board[i][j] != '.') {
+                int type = AGENT_TYPE(board[i][j]);
+                int happiness = happinessFromCounts(same[j], total[j]);
+
+                if (!wide) {
+                    band->pairs[type][total[j]][same[j]]++;
+                }
+                else {
+                    tallyWide(&band->wide, type, same[j], total[j],
+                              happiness, band->strengthThreshold);
+                }
+
+                // Mark it if the happiness is below the threshold
+                if (happiness < band->strengthThreshold) {
+                    size_t bit = rowStart + j;
+                    band->unhappy[bit / 64] |= (uint64_t)1 << (bit % 64);
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
 
 /**
  * getHappiness(): Finds the happiness rating for a specific char by comparing
@@ -99,106 +857,496 @@ double getHappiness(int dimensions, char board[dimensions][dimensions],
 
 
 /**
- * moveAgent(): Moves an endline or newline char to the next vacant spot either
- * the first or last available spot based on if first is false (0) or true 
- * (non-zero).
+ * moveAgent(): Moves an agent of any type to the vacant spot its policy
+ * picks, which for the default policy is the first or last available spot
+ * based on if first is false (0) or true (non-zero). The spot is looked up in
+ * the vacancy index instead of scanning the board, and is taken out of the
+ * index once it is filled. The move is recorded so the neighbor counts can
+ * be updated at the end of the cycle.
  */
-int moveAgent(int dimensions, char board[dimensions][dimensions],
-              char tempBoard[dimensions][dimensions], int row,
-              int col, int first) {
+int moveAgent(Game *game, int dimensions, char board[dimensions][dimensions],
+              int row, int col, int first) {
 
-    // If first is true, look for the first available spot
-    if (first) {
+    size_t cell = (size_t)row * dimensions + col;
 
-        // Nested for loops to look for '.' char in both board and tempBoard
-        for (int i = 0; i < dimensions; i++) {
-            for (int j = 0; j < dimensions; j++) {
-
-                // If the index is empty in both boards, swap the current char
-                // with the index found by the loops in board
-                if (tempBoard[i][j] == '.' && board[i][j] == '.') {
-                    board[i][j] = board[row][col];
-                    board[row][col] = '.';
-                    return 1;
-                }
-            }
+    // Find the spot the policy picks among those empty in both boards
+    long spot = pickVacancy(&game->vacancyIndex, &game->vacancies, cell,
+                            AGENT_TYPE(board[row][col]), first);
+    COUNT(&game->counters, vacancyLookups, 1);
+
+    // No vacant spot is left this cycle
+    if (spot < 0) {
+        return 0;
+    }
+
+    // Swap the current char with the spot found in board, and mark the spot
+    // as filled
+    board[spot / dimensions][spot % dimensions] = board[row][col];
+    board[row][col] = '.';
+    cellSetRemove(&game->vacancies, spot);
+    vacancyTaken(&game->vacancyIndex, spot);
+
+    // Remember the move for the end of the cycle
+    game->moveFrom[game->numMoves] = cell;
+    game->moveTo[game->numMoves] = spot;
+    game->moveAgent[game->numMoves] = board[spot / dimensions]
+                                           [spot % dimensions];
+    game->numMoves++;
+
+    return 1;
+}
+
+
+/**
+ * checkBands(): Finds the unhappy agents of every band, waking the workers
+ * to check theirs while the first band, and any band without a worker, is
+ * checked on this thread, then waits for the workers to finish.
+ */
+static void checkBands(Game *game, char *board, int strengthThreshold) {
+
+    double start = PHASE_START(&game->counters);
+    int workers = 0;  // Bands being checked by their worker
+
+    for (int t = 0; t < game->threads; t++) {
+        Band *band = &game->bands[t];
+        band->board = board;
+        band->strengthThreshold = strengthThreshold;
+        workers += band->running;
+    }
+
+    if (workers > 0) {
+        pthread_mutex_lock(&game->poolLock);
+        game->poolPending = workers;
+        game->poolRound++;
+        pthread_cond_broadcast(&game->poolStart);
+        pthread_mutex_unlock(&game->poolLock);
+    }
+
+    for (int t = 0; t < game->threads; t++) {
+        if (!game->bands[t].running) {
+            findUnhappy(&game->bands[t]);
+        }
+    }
+
+    if (workers > 0) {
+        pthread_mutex_lock(&game->poolLock);
+        while (game->poolPending > 0) {
+            pthread_cond_wait(&game->poolDone, &game->poolLock);
+        }
+        pthread_mutex_unlock(&game->poolLock);
+    }
+
+    COUNT(&game->counters, happinessChecks, game->numAgents);
+    PHASE_END(&game->counters, PHASE_CHECK, start);
+}
+
+
+/**
+ * isUnhappy(): Checks one agent against the threshold using the kept
+ * neighbor counts.
+ */
+static int isUnhappy(Game *game, int dimensions,
+                     char board[dimensions][dimensions], size_t cell,
+                     int strengthThreshold) {
+
+    int type = AGENT_TYPE(board[cell / dimensions][cell % dimensions]);
+
+    if (type < 0) {
+        return 0;
+    }
+
+    int total = game->totalNeighbors[cell];
+    int same = BY_TYPES(game->numTypes, sameNeighborsTyped, game, cell, type);
+    int happiness = happinessFromCounts(same, total);
+    return happiness < strengthThreshold;
+}
+
+
+/**
+ * checkCell(): Checks a cell whose neighbors may have changed, adding it to
+ * the unhappy agents if it is one and taking it out otherwise, and scoring
+ * it for the best policy if it is vacant. Most checks find nothing changed,
+ * which the bitmap shows without touching the much bigger list.
+ */
+static void checkCell(Game *game, int dimensions,
+                      char board[dimensions][dimensions], size_t cell,
+                      int strengthThreshold) {
+
+    scoreVacancy(game, cell);
+
+    int unhappy = isUnhappy(game, dimensions, board, cell, strengthThreshold);
+
+    if (unhappy == cellSetContains(&game->unhappy, cell)) {
+        return;
+    }
+
+    if (unhappy) {
+        cellSetInsert(&game->unhappy, cell);
+        if (game->update == UPDATE_ASYNC) {
+            workListInsert(&game->worklist, cell);
         }
     }
-    // Otherwise, look for the last available spot
     else {
+        cellSetRemove(&game->unhappy, cell);
+        if (game->update == UPDATE_ASYNC) {
+            workListRemove(&game->worklist, cell);
+        }
+    }
+}
+
+
+/**
+ * updateUnhappy(): Brings the set of unhappy agents up to date. An agent's
+ * happiness can only change if something in its 3x3 neighborhood changed,
+ * so only the cells marked dirty by the last cycle's moves are checked. The
+ * whole board is checked, a band per thread, the first time and whenever the
+ * threshold changes.
+ */
+static void updateUnhappy(Game *game, int dimensions,
+                          char board[dimensions][dimensions],
+                          int strengthThreshold) {
+
+    if (game->unhappyThreshold != strengthThreshold) {
+        checkBands(game, (char *)board, strengthThreshold);
 
-        // Nested for loops to look for '.' char in both board and tempBoard
-        for (int i = dimensions - 1; i >= 0; i--) {
-            for (int j = dimensions - 1; j >= 0; j--) {
+        // Copy the bits of every band into the set
+        clearCellSet(&game->unhappy);
+        for (int t = 0; t < game->threads; t++) {
+            Band *band = &game->bands[t];
+            size_t bandStart = (size_t)band->firstRow * dimensions;
+            size_t words = ((size_t)(band->endRow - band->firstRow) *
+                            dimensions + 63) / 64;
 
-                // If the index is empty in both boards, swap the current char
-                // with the index found by the loops in board
-                if (tempBoard[i][j] == '.' && board[i][j] == '.') {
-                    board[i][j] = board[row][col];
-                    board[row][col] = '.';
-                    return 1;
+            for (size_t w = 0; w < words; w++) {
+                for (uint64_t bits = band->unhappy[w]; bits != 0;
+                     bits &= bits - 1) {
+                    cellSetInsert(&game->unhappy,
+                                  bandStart + w * 64 + __builtin_ctzll(bits));
                 }
             }
         }
+
+        // The best policy still needs the new counts of the dirty vacancies
+        if (game->vacancyIndex.policy == POLICY_BEST) {
+            for (long cell = cellSetFirst(&game->dirty); cell >= 0;
+                 cell = cellSetNext(&game->dirty, cell + 1)) {
+                scoreVacancy(game, cell);
+            }
+        }
+
+        clearCellSet(&game->dirty);
+        game->unhappyThreshold = strengthThreshold;
+        return;
+    }
+
+    double start = PHASE_START(&game->counters);
+    size_t checked = 0;  // Dirty cells checked
+
+    // Check only the dirty cells, emptying the dirty set along the way
+    for (long cell = cellSetFirst(&game->dirty); cell >= 0;
+         cell = cellSetNext(&game->dirty, cell + 1)) {
+        cellSetRemove(&game->dirty, cell);
+        checkCell(game, dimensions, board, cell, strengthThreshold);
+        checked++;
+    }
+
+    COUNT(&game->counters, happinessChecks, checked);
+    PHASE_END(&game->counters, PHASE_CHECK, start);
+}
+
+
+/**
+ * markDirty(): Marks a cell and its up to 8 neighbors as needing their
+ * happiness checked next cycle.
+ */
+static void markDirty(Game *game, int dimensions, size_t cell) {
+
+    int row = cell / dimensions;
+    int col = cell % dimensions;
+
+    for (int di = -1; di <= 1; di++) {
+        int i = game->wrap[row + di + 1];
+
+        for (int dj = -1; dj <= 1; dj++) {
+            int j = game->wrap[col + dj + 1];
+
+            // Skip cells off a bounded board
+            if (i < 0 || j < 0) {
+                continue;
+            }
+
+            cellSetInsert(&game->dirty, (size_t)i * dimensions + j);
+        }
+    }
+}
+
+
+/**
+ * moveNext(): Moves one unhappy agent with moveAgent, switching between the
+ * first and last vacant spot after every move that was made.
+ */
+static int moveNext(Game *game, int dimensions,
+                    char board[dimensions][dimensions], size_t cell,
+                    int *first) {
+
+    // Move the char to a new, valid, empty spot
+    int validMove = moveAgent(game, dimensions, board, cell / dimensions,
+                              cell % dimensions, *first);
+
+    // Change first from 1 to 0 or vice versa to look for a vacant spot from
+    // the other end of the array next time an agent is moved
+    if (validMove) {
+        *first = (*first + 1) % 2;
     }
 
-    return 0;
+    return validMove;
 }
 
 
 /**
- * gameMove(): Moves as many chars as possible that do not meet the happiness
- * threshold using moveAgent, and returns the number of moves that were made. 
+ * checkAround(): Checks a cell and its up to 8 neighbors right away, as
+ * markDirty would have them checked next cycle, and gives how many were
+ * checked.
  */
-int gameMove(int dimensions, char board[dimensions][dimensions],
-             int strengthThreshold) {
+static size_t checkAround(Game *game, int dimensions,
+                          char board[dimensions][dimensions], size_t cell,
+                          int strengthThreshold) {
 
-    char tempBoard[dimensions][dimensions];  // Array to hold copy of board
+    int row = cell / dimensions;
+    int col = cell % dimensions;
+    size_t checked = 0;
 
-    int numMoves = 0;  // Set the number of moves to 0 to start
+    for (int di = -1; di <= 1; di++) {
+        int i = game->wrap[row + di + 1];
 
-    // Make a deep copy of board in tempBoard
-    for (int i = 0; i < dimensions; i++) {
-        for (int j = 0; j < dimensions; j++) {
-            tempBoard[i][j] = board[i][j];
+        for (int dj = -1; dj <= 1; dj++) {
+            int j = game->wrap[col + dj + 1];
+
+            // Skip cells off a bounded board
+            if (i < 0 || j < 0) {
+                continue;
+            }
+
+            checkCell(game, dimensions, board, (size_t)i * dimensions + j,
+                      strengthThreshold);
+            checked++;
+        }
+    }
+
+    return checked;
+}
+
+
+/**
+ * moveAsync(): Moves unhappy agents drawn at random one at a time, as many
+ * as were unhappy when the cycle started, or until there is no vacant spot.
+ * A spot an agent leaves can be moved into by the very next agent. The
+ * list is filled from the unhappy set in row order at the start of every
+ * cycle, so a game resumed from a checkpoint draws the same agents. Both
+ * the moves and the updates after them are timed as moving.
+ */
+static long moveAsync(Game *game, int dimensions,
+                      char board[dimensions][dimensions],
+                      int strengthThreshold) {
+
+    char *cells = (char *)board;
+    long numMoves = 0;
+    int first = 0;  // Switches between the last and first vacant spot
+    int vacanciesLeft = 1;  // Boolean, false once a move fails
+    size_t checked = 0;  // Cells checked after the moves
+
+    updateUnhappy(game, dimensions, board, strengthThreshold);
+    double start = PHASE_START(&game->counters);
+
+    clearWorkList(&game->worklist);
+    for (long cell = cellSetFirst(&game->unhappy); cell >= 0;
+         cell = cellSetNext(&game->unhappy, cell + 1)) {
+        workListInsert(&game->worklist, cell);
+    }
+
+    for (size_t steps = game->worklist.count;
+         steps > 0 && game->worklist.count > 0; steps--) {
+        size_t from = workListPick(&game->worklist, game->rng);
+        char agent = cells[from];
+        long to = pickVacancy(&game->vacancyIndex, &game->vacancies, from,
+                              AGENT_TYPE(agent), first);
+        COUNT(&game->counters, vacancyLookups, 1);
+
+        // Only a board with no vacant spots at all has nowhere to move
+        if (to < 0) {
+            vacanciesLeft = 0;
+            break;
         }
+
+        cellSetRemove(&game->vacancies, to);
+        vacancyTaken(&game->vacancyIndex, to);
+        cellSetInsert(&game->vacancies, from);
+        vacancyAdded(&game->vacancyIndex, from);
+        game->hash ^= agentHash(from, agent) ^ agentHash(to, agent);
+
+        tallyAgent(game, from, agent, -1);
+        cells[from] = '.';
+        changeNeighbors(game, dimensions, cells, from, agent, -1);
+        cells[to] = agent;
+        changeNeighbors(game, dimensions, cells, to, agent, 1);
+        tallyAgent(game, to, agent, 1);
+
+        checked += checkAround(game, dimensions, board, from,
+                               strengthThreshold);
+        checked += checkAround(game, dimensions, board, to,
+                               strengthThreshold);
+
+        game->moveFrom[game->numMoves] = from;
+        game->moveTo[game->numMoves] = to;
+        game->moveAgent[game->numMoves] = agent;
+        game->numMoves++;
+        numMoves++;
+        first = !first;
+    }
+
+    COUNT(&game->counters, cycles, 1);
+    COUNT(&game->counters, moves, numMoves);
+    COUNT(&game->counters, failedMoves, !vacanciesLeft);
+    COUNT(&game->counters, happinessChecks, checked);
+    PHASE_END(&game->counters, PHASE_MOVE, start);
+
+    return numMoves;
+}
+
+
+/**
+ * gameMove(): Moves as many chars as possible that do not meet the happiness
+ * threshold using moveAgent, and returns the number of moves that were made. 
+ * All the unhappy agents are found first and then moved in row order, just
+ * as if each had been checked right before moving. The counts kernel keeps
+ * a set of unhappy agents and only checks the cells around last cycle's
+ * moves, while the other kernels check every band, on its own thread when
+ * there is more than one. The neighbor counts, or the bitplanes they come
+ * from, are brought up to date around each move at the end.
+ */
+long gameMove(Game *game, int dimensions, char board[dimensions][dimensions],
+              int strengthThreshold) {
+
+    long numMoves = 0;  // Set the number of moves to 0 to start
+    game->numMoves = 0;
+    orderVacancies(&game->vacancyIndex, &game->vacancies);
+
+    if (game->update == UPDATE_ASYNC) {
+        return moveAsync(game, dimensions, board, strengthThreshold);
     }
 
     // Passed to moveAgent, will switch between 1 and 0 to make the function
     // find the first vacant space, then the last vacant space, then the first,
     // and so on
     int first = 0;
+    int vacanciesLeft = 1;  // No agent can move once a move fails
+    double start;  // Start of the phase being timed
 
-    // Nested loops go through each index in the array to find non-empty chars
-    for (int i = 0; i < dimensions; i++) {
-        for (int j = 0; j < dimensions; j++) {
+    if (game->kernel == KERNEL_COUNTS) {
+        updateUnhappy(game, dimensions, board, strengthThreshold);
+        start = PHASE_START(&game->counters);
 
-            // If non-empty find its happiness
-            if (tempBoard[i][j] != '.' && (tempBoard[i][j] == board[i][j])) {
+        // Go through the unhappy agents in row order until a move fails,
+        // since no vacant spot is left after that
+        for (long cell = cellSetFirst(&game->unhappy); cell >= 0;
+             cell = cellSetNext(&game->unhappy, cell + 1)) {
 
-                // Get the char's happiness
-                int happiness = getHappiness(dimensions, tempBoard, i, j);
+            if (!moveNext(game, dimensions, board, cell, &first)) {
+                vacanciesLeft = 0;
+                break;
+            }
+            cellSetRemove(&game->unhappy, cell);  // Its spot is vacant now
+            numMoves++;  // Increment the number of moves
+        }
+    }
+    else {
 
-                // If the happiness is below the threshold, move the char to
-                // a new, valid, empty spot
-                if (happiness < strengthThreshold) {
-                    int validMove = moveAgent(dimensions, board, tempBoard,
-                                              i, j, first);
+        // The bands may already have been checked by boardStats
+        if (game->unhappyThreshold != strengthThreshold) {
+            checkBands(game, (char *)board, strengthThreshold);
+        }
+        game->unhappyThreshold = -1;  // The moves below make them stale
+        start = PHASE_START(&game->counters);
 
-                    // Increment numMoves only if a move was made
-                    if (validMove) {
-                        numMoves++;  // Increment the number of moves
+        // Go through the unhappy agents of each band in row order
+        for (int t = 0; t < game->threads && vacanciesLeft; t++) {
+            Band *band = &game->bands[t];
+            size_t bandStart = (size_t)band->firstRow * dimensions;
+            size_t words = ((size_t)(band->endRow - band->firstRow) *
+                            dimensions + 63) / 64;
 
-                        // Change first from 1 to 0 or vice versa to look for
-                        // a vacant spot from the other end of the array next
-                        // time an agent is moved
-                        first = (first + 1) % 2;
+            for (size_t w = 0; w < words && vacanciesLeft; w++) {
+                for (uint64_t bits = band->unhappy[w]; bits != 0;
+                     bits &= bits - 1) {
+                    size_t cell = bandStart + w * 64 + __builtin_ctzll(bits);
+
+                    if (!moveNext(game, dimensions, board, cell, &first)) {
+                        vacanciesLeft = 0;
+                        break;
                     }
+                    numMoves++;  // Increment the number of moves
                 }
             }
         }
     }
 
+    COUNT(&game->counters, cycles, 1);
+    COUNT(&game->counters, moves, numMoves);
+    COUNT(&game->counters, failedMoves, !vacanciesLeft);
+    PHASE_END(&game->counters, PHASE_MOVE, start);
+    start = PHASE_START(&game->counters);
+
+    char *cells = (char *)board;
+
+    // Put the agents back where they came from so the moves can be replayed
+    // one at a time below, keeping the tally in step with the board
+    if (game->kernel == KERNEL_COUNTS) {
+        for (size_t m = game->numMoves; m-- > 0;) {
+            cells[game->moveFrom[m]] = cells[game->moveTo[m]];
+            cells[game->moveTo[m]] = '.';
+        }
+    }
+
+    // The spots agents left can be moved into next cycle, and the hash and
+    // the neighbors of both ends of every move change
+    for (size_t m = 0; m < game->numMoves; m++) {
+        size_t from = game->moveFrom[m];
+        size_t to = game->moveTo[m];
+        char agent = game->moveAgent[m];
+
+        cellSetInsert(&game->vacancies, from);
+        vacancyAdded(&game->vacancyIndex, from);
+        game->hash ^= agentHash(from, agent) ^ agentHash(to, agent);
+
+        if (game->kernel == KERNEL_COUNTS) {
+            tallyAgent(game, from, agent, -1);
+            cells[from] = '.';
+            changeNeighbors(game, dimensions, cells, from, agent, -1);
+            cells[to] = agent;
+            changeNeighbors(game, dimensions, cells, to, agent, 1);
+            tallyAgent(game, to, agent, 1);
+
+            markDirty(game, dimensions, from);
+            markDirty(game, dimensions, to);
+        }
+        else if (game->kernel == KERNEL_PACKED) {
+            packedSetCell(&game->packed, from / dimensions, from % dimensions,
+                          '.');
+            packedSetCell(&game->packed, to / dimensions, to % dimensions,
+                          agent);
+        }
+        else if (game->kernel == KERNEL_CHAR) {
+            haloSetCell(game, from, '.');
+            haloSetCell(game, to, agent);
+        }
+    }
+
+    // The ghost cells of a torus are copied from the new edges once a cycle
+    if (game->kernel == KERNEL_CHAR) {
+        refreshHalo(game);
+    }
+    PHASE_END(&game->counters, PHASE_UPDATE, start);
+
     // Calculate and return the total number of moves
     return numMoves;
 }
@@ -206,27 +1354,213 @@ int gameMove(int dimensions, char board[dimensions][dimensions],
 
 /**
  * getBoardHappiness(): Computes the average happiness for the entire board
- * by using getHappiness on each non-vacant char, summing all of them, and
- * dividing by the total number of non-vacant chars in the array.
+ * by getting the neighbor counts of each non-vacant char from the kernel,
+ * summing all of them, and dividing by the total number of non-vacant chars
+ * in the array, keeping a sum and count for each type along the way.
  */
-double getBoardHappiness(int dimensions, char board[dimensions][dimensions]) {
+double getBoardHappiness(Game *game, int dimensions,
+                         char board[dimensions][dimensions],
+                         double typeHappiness[]) {
 
     double totalHappiness = 0;  // Will hold the grid's happiness level
-    int numCounted = 0;  // Counts the number of non-empty chars in the grid
+    size_t numCounted = 0;  // Counts the number of non-empty chars in the grid
+    double typeTotals[MAX_TYPES] = { 0 };  // Happiness of each type
+    size_t typeCounted[MAX_TYPES] = { 0 };  // Chars of each type
+    Band *band = &game->bands[0];  // Only its row arrays are used
+    double start = PHASE_START(&game->counters);
+
+    restartBoxFilter(&band->box);
 
     for (int i = 0; i < dimensions; i++) {
+
+        // Get the neighbor counts of the whole row
+        rowCounts(game, band, dimensions, board, i);
+        const uint16_t *same = band->rowSame;
+        const uint16_t *total = band->rowTotal;
+
         for (int j = 0; j < dimensions; j++) {
+            int type = AGENT_TYPE(board[i][j]);
 
-            if (board[i][j] != '.') {
+            if (type >= 0) {
 
-                // Get the char's happiness and add it to the total
-                totalHappiness += getHappiness(dimensions, board, i, j);
+                // Get the char's happiness and add it to the totals
+                double happiness = happinessFromCounts(same[j], total[j]);
+                totalHappiness += happiness;
+                typeTotals[type] += happiness;
                 numCounted++;  // Increment the number of valid chars
+                typeCounted[type]++;
             }
         }
     }
 
+    if (typeHappiness != NULL) {
+        for (int k = 0; k < game->numTypes; k++) {
+            typeHappiness[k] = typeCounted[k] > 0 ?
+                               (typeTotals[k] / typeCounted[k]) / 100.0 : 0;
+        }
+    }
+
+    COUNT(&game->counters, happinessChecks, numCounted);
+    PHASE_END(&game->counters, PHASE_BOARD_HAPPINESS, start);
+
     // Return the average happiness for the board
     return (totalHappiness / numCounted) / 100.0;
 }
 
+
+/**
+ * pairStats(): Works out the statistics of the board from the number of
+ * agents of each type with each pair of neighbor counts. The happiness of
+ * every agent is a multiple of 1/840, since 840 is divisible by every
+ * possible number of neighbors, so the sums are kept exactly as counts of
+ * those.
+ */
+static void pairStats(size_t pairs[][9][9], int numTypes,
+                      int strengthThreshold, StepStats *stats) {
+
+    uint64_t scaledHappiness = 0;  // Sum of the happiness in 840ths
+
+    stats->agents = 0;
+    stats->unhappy = 0;
+    memset(stats->histogram, 0, sizeof(stats->histogram));
+    memset(stats->typeAgents, 0, sizeof(stats->typeAgents));
+    memset(stats->typeHappiness, 0, sizeof(stats->typeHappiness));
+
+    for (int type = 0; type < numTypes; type++) {
+        uint64_t typeScaled = 0;  // Sum of the type's happiness in 840ths
+
+        for (int total = 0; total <= 8; total++) {
+            for (int same = 0; same <= total; same++) {
+                size_t agents = pairs[type][total][same];
+
+                if (agents == 0) {
+                    continue;
+                }
+
+                int happiness = happinessFromCounts(same, total);
+
+                typeScaled += agents * (total > 0 ? same * (840 / total) :
+                                        840);
+                stats->typeAgents[type] += agents;
+                stats->histogram[happiness / 10] += agents;
+
+                if (happiness < strengthThreshold) {
+                    stats->unhappy += agents;
+                }
+            }
+        }
+
+        if (stats->typeAgents[type] > 0) {
+            stats->typeHappiness[type] = typeScaled /
+                                         (840.0 * stats->typeAgents[type]);
+        }
+        scaledHappiness += typeScaled;
+        stats->agents += stats->typeAgents[type];
+    }
+
+    stats->happiness = scaledHappiness / (840.0 * stats->agents);
+}
+
+
+/**
+ * wideStats(): Works out the statistics of the board from the wide tallies
+ * of the bands.
+ */
+static void wideStats(Game *game, StepStats *stats) {
+
+    uint64_t scaledHappiness = 0;  // Sum of the happiness in fixed point
+    double one = (double)((uint64_t)1 << HAPPINESS_FRACTION_BITS);
+
+    stats->agents = 0;
+    stats->unhappy = 0;
+    memset(stats->histogram, 0, sizeof(stats->histogram));
+    memset(stats->typeAgents, 0, sizeof(stats->typeAgents));
+    memset(stats->typeHappiness, 0, sizeof(stats->typeHappiness));
+
+    for (int t = 0; t < game->threads; t++) {
+        const WideTally *wide = &game->bands[t].wide;
+
+        for (int b = 0; b < HAPPINESS_BUCKETS; b++) {
+            stats->histogram[b] += wide->histogram[b];
+        }
+        stats->unhappy += wide->unhappy;
+    }
+
+    for (int type = 0; type < game->numTypes; type++) {
+        uint64_t typeScaled = 0;  // Sum of the type's happiness
+
+        for (int t = 0; t < game->threads; t++) {
+            stats->typeAgents[type] += game->bands[t].wide.typeAgents[type];
+            typeScaled += game->bands[t].wide.typeScaled[type];
+        }
+
+        if (stats->typeAgents[type] > 0) {
+            stats->typeHappiness[type] = typeScaled /
+                                         (one * stats->typeAgents[type]);
+        }
+        scaledHappiness += typeScaled;
+        stats->agents += stats->typeAgents[type];
+    }
+
+    stats->happiness = scaledHappiness / (one * stats->agents);
+}
+
+
+/**
+ * boardStats(): Adds up the game's tally for the counts kernel. The other
+ * kernels check every band first unless that was already done for this board
+ * and threshold, which also leaves the unhappy agents ready for gameMove.
+ */
+void boardStats(Game *game, int dimensions,
+                char board[dimensions][dimensions], int strengthThreshold,
+                StepStats *stats) {
+
+    if (game->kernel != KERNEL_COUNTS &&
+        game->unhappyThreshold != strengthThreshold) {
+        checkBands(game, (char *)board, strengthThreshold);
+        game->unhappyThreshold = strengthThreshold;
+    }
+
+    double start = PHASE_START(&game->counters);
+
+    if (game->kernel == KERNEL_COUNTS) {
+        pairStats(game->pairs, game->numTypes, strengthThreshold, stats);
+    }
+    else if (game->radius > 1) {
+        wideStats(game, stats);
+    }
+    else {
+        // Add the tallies of the bands together
+        size_t pairs[MAX_TYPES][9][9] = {{{0}}};
+
+        for (int t = 0; t < game->threads; t++) {
+            for (int type = 0; type < game->numTypes; type++) {
+                for (int total = 0; total <= 8; total++) {
+                    for (int same = 0; same <= total; same++) {
+                        pairs[type][total][same] +=
+                            game->bands[t].pairs[type][total][same];
+                    }
+                }
+            }
+        }
+
+        pairStats(pairs, game->numTypes, strengthThreshold, stats);
+    }
+
+    PHASE_END(&game->counters, PHASE_STATS, start);
+}
+
+
+/**
+ * gameStep(): Moves the unhappy agents, then finds the statistics of the new
+ * board. For the kernels that check bands, the one pass over the new board
+ * finds both the statistics and the agents that will move next cycle.
+ */
+long gameStep(Game *game, int dimensions, char board[dimensions][dimensions],
+              int strengthThreshold, StepStats *stats) {
+
+    stats->moves = gameMove(game, dimensions, board, strengthThreshold);
+    boardStats(game, dimensions, board, strengthThreshold, stats);
+
+    return stats->moves;
+}
@@ -15,6 +15,242 @@
 #ifndef _PLAY_GAME_H_
 #define _PLAY_GAME_H_
 
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "agent_types.h"
+#include "box_filter.h"
+#include "cell_set.h"
+#include "counters.h"
+#include "game_types.h"
+#include "packed_board.h"
+#include "rng.h"
+#include "vacancy_index.h"
+#include "work_list.h"
+
+
+// Most threads gameMove can split a cycle between
+#define MAX_THREADS 256
+
+// Bits kept after the point of each agent's happiness when it is added up
+// for a neighborhood radius above 1
+#define HAPPINESS_FRACTION_BITS 24
+
+
+/**
+ * WideTally adds up the agents of a band when a neighborhood is too big for
+ * a tally of every pair of counts. Each agent's happiness is added in fixed
+ * point, so the sums come out the same however the rows are split up.
+ */
+typedef struct {
+    size_t typeAgents[MAX_TYPES];          // agents of each type
+    uint64_t typeScaled[MAX_TYPES];        // happiness of each type's agents
+                                           // in 2^-HAPPINESS_FRACTION_BITS
+    size_t histogram[HAPPINESS_BUCKETS];   // agents by happiness / 10
+    size_t unhappy;                        // agents below the threshold
+} WideTally;
+
+
+struct Game;
+
+
+/**
+ * Band is a range of rows that one thread checks for unhappy agents at the
+ * start of a cycle, along with the scratch space the thread counts with.
+ */
+typedef struct {
+    struct Game *game;         // the game the band belongs to
+    char *board;               // the board being checked this cycle
+    int strengthThreshold;     // happiness needed to stay in place
+    int firstRow;              // first row of the band
+    int endRow;                // row just past the end of the band
+    uint64_t *unhappy;         // bit set for each unhappy agent in the band
+    uint16_t *rowSame;         // same-type neighbor counts of one row
+    uint16_t *rowTotal;        // non-vacant neighbor counts of one row
+    uint64_t *scratch;         // scratch space for KERNEL_PACKED
+    BoxFilter box;             // column counts for KERNEL_BOX
+    size_t pairs[MAX_TYPES][9][9];  // agents by [type][total][same]
+                                    // neighbors, for a radius of 1
+    WideTally wide;            // agents added up, for a bigger radius
+    pthread_t thread;          // the worker that checks the band
+    int running;               // 1 if a worker was started for the band
+} Band;
+
+
+/**
+ * Game holds the state that gameMove keeps from one cycle to the next so it
+ * does not have to rebuild it from the board every time: the number of
+ * occupied neighbors and neighbors of each type of every cell or the
+ * bitplanes or a copy of the board with a ring of ghost cells around it
+ * depending on the kernel, where the edges of the board wrap around to, the
+ * index of vacant cells and the index the move policy keeps on top of it,
+ * the set of unhappy agents and the cells whose
+ * happiness may have changed, the list the async update draws unhappy agents
+ * from, a tally of the agents by their type and
+ * neighbor counts, the bands of rows each thread checks and the workers
+ * kept waiting to check them every cycle, the list of moves
+ * made during the current cycle, a hash of the board that changes with
+ * every move, and the counters of the work done so far.
+ */
+typedef struct Game {
+    int dimensions;            // the size of the square board
+    int numTypes;              // types of agents in the board
+    int radius;                // rows and columns on each side of a cell
+                               // that are its neighbors
+    int torus;                 // boolean, true if the board wraps around
+    Kernel kernel;             // how neighbor counts are found
+    int threads;               // number of bands checked at the same time
+    Band *bands;               // the rows each thread checks
+    pthread_mutex_t poolLock;  // held while the workers are started on the
+                               // bands or one reports its band checked
+    pthread_cond_t poolStart;  // signaled when the bands are ready to check
+    pthread_cond_t poolDone;   // signaled when the last worker is done
+    unsigned long poolRound;   // counts up every time the bands are checked
+    int poolPending;           // workers still checking their bands
+    int poolStop;              // boolean, true when the workers must exit
+    int poolReady;             // boolean, true once poolLock, poolStart, and
+                               // poolDone are set up
+    uint8_t *typeNeighbors;    // neighbors of each type but the last, a
+                               // plane of every cell for each type
+    uint8_t *totalNeighbors;   // non-vacant neighbors of each cell
+    PackedBoard packed;        // bitplanes of the board for KERNEL_PACKED
+    char *halo;                // the board inside a ring of ghost cells that
+                               // are vacant or wrapped around, for
+                               // KERNEL_CHAR
+    int *wrap;                 // the row or column at each index from -1 to
+                               // dimensions, or -1 if it is off the board
+    CellSet vacancies;         // cells that are vacant in the board
+    VacancyIndex vacancyIndex; // what the move policy picks vacancies with
+    CellSet unhappy;           // unhappy agents, for KERNEL_COUNTS
+    CellSet dirty;             // cells to check for unhappiness next cycle
+    UpdateMode update;         // how the agents of a cycle are moved
+    WorkList worklist;         // unhappy agents to draw from, for
+                               // UPDATE_ASYNC
+    Rng *rng;                  // generator UPDATE_ASYNC draws agents with
+    size_t pairs[MAX_TYPES][9][9];  // agents by [type][total][same]
+                                    // neighbors, for KERNEL_COUNTS
+    int unhappyThreshold;      // threshold the unhappy agents were found for,
+                               // or -1 if they are out of date
+    size_t *moveFrom;          // cells agents moved from this cycle
+    size_t *moveTo;            // cells agents moved to this cycle
+    char *moveAgent;           // the agent that made each move, since with
+                               // UPDATE_ASYNC it may have moved on since
+    size_t numMoves;           // number of moves in moveFrom, moveTo, and
+                               // moveAgent
+    size_t numAgents;          // agents in the board, which never changes
+    uint64_t hash;             // hash of every agent and the cell it is in
+    Counters counters;         // work counted and timed, once turned on
+} Game;
+
+
+/**
+ * initGame allocates the state for a board and counts the neighbors of
+ * every cell in it. The number of vacant cells never changes, so the move
+ * lists are sized to hold one move per vacant cell. A worker thread is
+ * started for every band but the first, and waits to check its band each
+ * cycle until freeGame stops it, so game must not be moved once it is set
+ * up. The counters start out off, and agents move with POLICY_FIRST_LAST
+ * and UPDATE_SYNC.
+ *
+ * @param game        the state to initialize
+ * @param dimensions  the size of the square 2D array given
+ * @param board       a 2D array of chars that has been populated
+ * @param numTypes    the number of types of agents, from 2 to MAX_TYPES
+ * @param radius      rows and columns on each side of a cell that are its
+ *                    neighbors, 1 for the 8 cells around it, and only above
+ *                    1 for KERNEL_BOX, up to MAX_RADIUS
+ * @param torus       1 if the board wraps around at the edges, in which case
+ *                    it must be at least 2 * radius + 1 wide, 0 if the cells
+ *                    on the edges have fewer neighbors
+ * @param kernel      how neighbor counts will be found
+ * @param threads     how many threads check the board for unhappy agents,
+ *                    from 1 to MAX_THREADS
+ * @returns           1 if the state was set up, 0 if memory ran out
+ */
+int initGame(Game *game, int dimensions, char board[dimensions][dimensions],
+             int numTypes, int radius, int torus, Kernel kernel,
+             int threads);
+
+
+/**
+ * freeGame releases the memory held by the state of a game.
+ *
+ * @param game  the state to free
+ */
+void freeGame(Game *game);
+
+
+/**
+ * setMovePolicy changes how unhappy agents pick the vacant spot they move
+ * to, building the index the policy needs from the vacant cells.
+ *
+ * @param game    the state of the game
+ * @param policy  the policy to move with, where POLICY_BEST needs
+ *                KERNEL_COUNTS for the neighbor counts of vacant cells
+ * @param rng     the generator POLICY_RANDOM draws from, which must last as
+ *                long as the game, or NULL for the other policies
+ * @returns       1 if the policy was set, 0 if memory ran out
+ */
+int setMovePolicy(Game *game, MovePolicy policy, Rng *rng);
+
+
+/**
+ * setUpdateMode changes how the unhappy agents of a cycle are moved. The
+ * async update makes as many moves a cycle as there were unhappy agents
+ * when it started, so the move lists grow to hold one move per agent.
+ *
+ * @param game  the state of the game, which must use KERNEL_COUNTS for
+ *              UPDATE_ASYNC
+ * @param mode  the update to move with
+ * @param rng   the generator UPDATE_ASYNC draws agents from, which must
+ *              last as long as the game, or NULL for UPDATE_SYNC
+ * @returns     1 if the update was set, 0 if memory ran out
+ */
+int setUpdateMode(Game *game, UpdateMode mode, Rng *rng);
+
+
+/**
+ * countNeighbors counts the non-vacant chars around a specific row and
+ * column, and how many of them are the same type as the char there.
+ *
+ * @param dimensions  the size of the square 2D array given
+ * @param board       a 2D array of chars
+ * @param row         the specified row for the current char
+ * @param col         the specified column for the current char
+ * @param same        set to the number of neighbors that are the same type
+ * @param total       set to the number of non-vacant neighbors
+ */
+void countNeighbors(int dimensions, char board[dimensions][dimensions],
+                    int row, int col, int *same, int *total);
+
+
+/**
+ * happinessFromCounts turns neighbor counts into a happiness rating, the same
+ * way getHappiness does.
+ *
+ * @param same   the number of neighbors that are the same type
+ * @param total  the number of non-vacant neighbors
+ * @returns      the percentage of non-vacant neighbors that are the same
+ *               type, or 100 if there are none
+ */
+double happinessFromCounts(int same, int total);
+
+
+/**
+ * agentHash mixes a cell and the agent in it into a hash. A board's hash is
+ * the XOR of this over every agent in it.
+ *
+ * @param cell   the index of the cell, row * dimensions + col
+ * @param agent  the char of the agent in the cell
+ * @returns      64 random-looking bits for the agent in the cell
+ */
+uint64_t agentHash(size_t cell, char agent);
+
 /**
  * getHappiness compares a char at a specific row and column to its 8
  * surrounding neighbors to find the percentage of the neighboring
@@ -32,51 +268,106 @@ double getHappiness(int dimensions, char board[dimensions][dimensions],
 
 
 /**
- * moveAgent moves a single char in the grid to the first or last vacant '.'
- * spot in the 2D array depending on the parameter 'first'.
+ * moveAgent moves a single char in the grid to the vacant '.' spot picked by
+ * the game's move policy, which for the default policy is the first or last
+ * one in the 2D array depending on the parameter 'first'. The vacant spots
+ * that can be used are the ones vacant in both the board from the previous
+ * cycle and the board being updated, which are kept in a vacancy index so
+ * that no scan of the board is needed.
  *
+ * @param game        the state kept between cycles, holding the cells that
+ *                    are vacant in both board and the board from the previous
+ *                    cycle, the spot taken is removed and the move recorded
  * @param dimensions  the size of the square 2D array given
- * @param board       the new board that is being updated currently, used
- *                    to determine which open spaces have not been filled
- * @param tempBoard   the board from the previous cycle, used to determine
- *                    which spaces are open to move the char to
+ * @param board       the new board that is being updated currently
  * @param row         the specified row for the char to move
  * @param col         the specified colomn for the char to move
  * @param first       represents a boolean, 1 if the first vacant spot should
  *                    be found, 0 if the last vacnt spot should be found
  * @returns           1 if the char was successfully moved, 0 otherwise
  */
-int moveAgent(int dimensions, char board[dimensions][dimensions],
-              char tempBoard[dimensions][dimensions], int row,
-              int col, int first);
+int moveAgent(Game *game, int dimensions, char board[dimensions][dimensions],
+              int row, int col, int first);
 
 
 /**
  * gameMove find the happiness rating for every non-empty char in the board,
  * and moves it to a new empty location if it is below the happiness threshold
- * if possible. It counts the total number of moves made.
+ * if possible. It counts the total number of moves made. Happiness comes from
+ * the neighbor counts found by the game's kernel. The unhappy agents are all
+ * found before any of them move, and then moved in row order, so the board
+ * ends up the same no matter how many threads are used. With the counts
+ * kernel only the agents around the last cycle's moves are checked again,
+ * so a cycle costs about as much as the moves it makes. The other kernels
+ * check every band of rows, each on one of the game's threads. Only the
+ * state around the cells that changed is updated afterwards. With
+ * UPDATE_ASYNC the agents are drawn at random instead, and the counts and
+ * unhappy agents around each move are updated before the next is drawn.
  *
+ * @param game               the state kept between cycles for board
  * @param dimensions         the size of the square 2D array given
  * @param board              a 2D array of chars
  * @param strengthThreshold  the happiness value a char must be greater than
  *                           or equal to to stay in place
  * @returns                  the number of moves made this cycle
  */
-int gameMove(int dimensions, char board[dimensions][dimensions],
-             int strengthThreshold);
+long gameMove(Game *game, int dimensions, char board[dimensions][dimensions],
+              int strengthThreshold);
 
 
 /**
  * getBoardHappiness calculates the happiness rating for the entire board which
- * is found by averaging the happiness ratings of all the endline and newline
- * chars in the board.
+ * is found by averaging the happiness ratings of all the agents in the board,
+ * using the neighbor counts from the game's kernel, along with the average
+ * happiness of the agents of each type.
  *
- * @param dimensions  the size of the square 2D array given
- * @param board       a 2D array of chars
- * @returns           the average happiness of the endline and newline chars
- *                    in board
+ * @param game           the state kept between cycles for board
+ * @param dimensions     the size of the square 2D array given
+ * @param board          a 2D array of chars
+ * @param typeHappiness  filled with the average happiness of each type, 0 for
+ *                       a type with no agents, unless it is NULL
+ * @returns              the average happiness of the agents in board
+ */
+double getBoardHappiness(Game *game, int dimensions,
+                         char board[dimensions][dimensions],
+                         double typeHappiness[]);
+
+
+
+/**
+ * boardStats finds the average happiness of the board, how many agents are
+ * below the threshold, and how the happiness of the agents is spread out,
+ * without moving anything. moves is left as it is.
+ *
+ * @param game               the state kept between cycles for board
+ * @param dimensions         the size of the square 2D array given
+ * @param board              a 2D array of chars
+ * @param strengthThreshold  the happiness value a char must be greater than
+ *                           or equal to to stay in place
+ * @param stats              filled with the statistics of the board
+ */
+void boardStats(Game *game, int dimensions,
+                char board[dimensions][dimensions], int strengthThreshold,
+                StepStats *stats);
+
+
+/**
+ * gameStep advances the board by one cycle with gameMove and fills in the
+ * statistics of the new board, which are kept up to date as agents move or
+ * found in the same pass over the board that finds the next cycle's unhappy
+ * agents, so the board does not have to be gone over a second time.
+ *
+ * @param game               the state kept between cycles for board
+ * @param dimensions         the size of the square 2D array given
+ * @param board              a 2D array of chars
+ * @param strengthThreshold  the happiness value a char must be greater than
+ *                           or equal to to stay in place
+ * @param stats              filled with the moves made and the statistics
+ *                           of the new board
+ * @returns                  the number of moves made this cycle
  */
-double getBoardHappiness(int dimensions, char board[dimensions][dimensions]);
+long gameStep(Game *game, int dimensions, char board[dimensions][dimensions],
+              int strengthThreshold, StepStats *stats);
 
 
 // End include guard
@@ -0,0 +1,128 @@
+//
+// File: rng.c
+// Description: Contains the xoshiro256** generator, its splitmix64 seeding,
+// and its jump function, following the reference versions by Blackman and
+// Vigna.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "rng.h"
+
+
+// 128-bit products for rngBelow, a GCC extension
+__extension__ typedef unsigned __int128 RngWide;
+
+
+/**
+ * rotateLeft(): Rotates the bits of a word left.
+ */
+static uint64_t rotateLeft(uint64_t x, int k) {
+
+    return (x << k) | (x >> (64 - k));
+}
+
+
+/**
+ * seedRng(): Runs splitmix64 from the seed to get each word of the state.
+ */
+void seedRng(Rng *rng, uint64_t seed) {
+
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        rng->s[i] = z ^ (z >> 31);
+    }
+}
+
+
+/**
+ * rngNext(): Scrambles the second word into the result, then advances the
+ * state with xors, a shift, and a rotate.
+ */
+uint64_t rngNext(Rng *rng) {
+
+    uint64_t *s = rng->s;
+    uint64_t result = rotateLeft(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotateLeft(s[3], 45);
+
+    return result;
+}
+
+
+/**
+ * rngBelow(): Takes the high word of the random bits times the bound. The
+ * low word shows when the result would be biased, which only happens for
+ * the first 2^64 % bound values of it.
+ */
+uint64_t rngBelow(Rng *rng, uint64_t bound) {
+
+    RngWide product = (RngWide)rngNext(rng) * bound;
+    uint64_t low = (uint64_t)product;
+
+    if (low < bound) {
+        uint64_t threshold = -bound % bound;
+
+        while (low < threshold) {
+            product = (RngWide)rngNext(rng) * bound;
+            low = (uint64_t)product;
+        }
+    }
+
+    return (uint64_t)(product >> 64);
+}
+
+
+/**
+ * rngJump(): Adds together the states the generator passes through at the
+ * bits set in the jump polynomial.
+ */
+void rngJump(Rng *rng) {
+
+    static const uint64_t jump[] = {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+        0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
+
+    uint64_t s[4] = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < 4; i++) {
+        for (int b = 0; b < 64; b++) {
+            if (jump[i] & ((uint64_t)1 << b)) {
+                s[0] ^= rng->s[0];
+                s[1] ^= rng->s[1];
+                s[2] ^= rng->s[2];
+                s[3] ^= rng->s[3];
+            }
+            rngNext(rng);
+        }
+    }
+
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = s[i];
+    }
+}
+
+
+/**
+ * rngStream(): Copies the generator and jumps the copy once per index.
+ */
+void rngStream(Rng *stream, const Rng *rng, int index) {
+
+    *stream = *rng;
+
+    for (int i = 0; i < index; i++) {
+        rngJump(stream);
+    }
+}
@@ -0,0 +1,83 @@
+//
+// File: rng.h
+// Description: Provides the random number generator used to set up boards,
+// xoshiro256** seeded through splitmix64. Its state is a plain struct, so
+// every thread can have its own generator without any locking, and jumping
+// a generator ahead by 2^128 numbers gives streams that never overlap, so a
+// seed can be split into one stream per thread or per block of work.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for rng.h
+#ifndef _RNG_H_
+#define _RNG_H_
+
+#include <stdint.h>
+
+
+/**
+ * Rng is the state of one xoshiro256** generator.
+ */
+typedef struct {
+    uint64_t s[4];    // never all zero once seeded
+} Rng;
+
+
+/**
+ * seedRng fills the state of a generator from a 64-bit seed using
+ * splitmix64, so nearby seeds still give unrelated numbers.
+ *
+ * @param rng   the generator to seed
+ * @param seed  any 64-bit value
+ */
+void seedRng(Rng *rng, uint64_t seed);
+
+
+/**
+ * rngNext gives the next 64 random bits of a generator.
+ *
+ * @param rng  the generator to advance
+ * @returns    64 random bits
+ */
+uint64_t rngNext(Rng *rng);
+
+
+/**
+ * rngBelow gives a random number in [0, bound) with every value equally
+ * likely, using a multiply and shift instead of a modulo, and only rarely
+ * drawing a second number to avoid bias.
+ *
+ * @param rng    the generator to advance
+ * @param bound  one more than the largest value wanted, at least 1
+ * @returns      a random number in [0, bound)
+ */
+uint64_t rngBelow(Rng *rng, uint64_t bound);
+
+
+/**
+ * rngJump moves a generator ahead by 2^128 numbers, the same as calling
+ * rngNext that many times.
+ *
+ * @param rng  the generator to jump
+ */
+void rngJump(Rng *rng);
+
+
+/**
+ * rngStream sets up the given stream of a generator, a copy jumped ahead
+ * index times. Streams with different indices never give the same run of
+ * numbers, and depend only on the generator and the index, not on which
+ * thread sets them up.
+ *
+ * @param stream  the generator to set up
+ * @param rng     the generator the streams are split from
+ * @param index   which stream to give, from 0
+ */
+void rngStream(Rng *stream, const Rng *rng, int index);
+
+
+// End include guard
+#endif
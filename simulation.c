@@ -0,0 +1,289 @@
+//
+// File: simulation.c
+// Description: Contains the functions for a simulation behind a handle. A
+// simulation is set up the same way bracetopia sets up a board, so the
+// same config and seed give the same board and the same cycles as the
+// command line does.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "simulation.h"
+
+#include <stdlib.h>
+
+#include "box_filter.h"
+#include "init_board.h"
+#include "play_game.h"
+
+
+// Turns the value of a limit into a string, so the messages checkConfig
+// gives stay constant but show the number rather than the macro's name
+#define STRINGIFY(value) #value
+#define LIMIT(macro) STRINGIFY(macro)
+
+
+/**
+ * Simulation holds everything one simulation needs, none of which is shared
+ * with any other.
+ */
+struct Simulation {
+    SimConfig config;    // the settings it was created with
+    char *board;         // the board, allocated by allocBoard
+    Rng rng;             // generator the board was shuffled with, which the
+                         // random policy and the async update draw from
+    Game game;           // the state gameMove keeps between cycles
+    StepStats stats;     // statistics of the board as it is now
+    int cycle;           // cycles run since it was created
+};
+
+
+/**
+ * simDefaultConfig(): Fills in the defaults of bracetopia's flags.
+ */
+void simDefaultConfig(SimConfig *config) {
+
+    config->dimensions = 15;
+    config->strengthThreshold = 50;
+    config->vacancy = 20;
+    config->numTypes = 2;
+    config->typePercents[0] = 60;
+    config->typePercents[1] = 40;
+    for (int k = 2; k < MAX_TYPES; k++) {
+        config->typePercents[k] = 0;
+    }
+    config->radius = 1;
+    config->torus = 0;
+    config->kernel = KERNEL_COUNTS;
+    config->threads = 1;
+    config->policy = POLICY_FIRST_LAST;
+    config->update = UPDATE_SYNC;
+    config->seed = 0;
+}
+
+
+/**
+ * checkConfig(): Checks every setting against the same limits bracetopia's
+ * flags have, giving a message for the first one that is out of range, or
+ * NULL if they are all fine.
+ */
+static const char *checkConfig(const SimConfig *config) {
+
+    if (config->dimensions < 5 || config->dimensions > MAX_DIMENSIONS) {
+        return "dimensions must be from 5 to " LIMIT(MAX_DIMENSIONS);
+    }
+    if (config->strengthThreshold < 1 || config->strengthThreshold > 99) {
+        return "strength of preference must be from 1 to 99";
+    }
+    if (config->vacancy < 1 || config->vacancy > 99) {
+        return "vacancy must be from 1 to 99";
+    }
+    if (config->numTypes < 2 || config->numTypes > MAX_TYPES) {
+        return "there must be from 2 to " LIMIT(MAX_TYPES) " types";
+    }
+
+    int sum = 0;  // Adds up the type percentages
+    for (int k = 0; k < config->numTypes; k++) {
+        if (config->typePercents[k] < 1 || config->typePercents[k] > 99) {
+            return "type percentages must be from 1 to 99";
+        }
+        sum += config->typePercents[k];
+    }
+    if (sum != 100) {
+        return "type percentages must add up to 100";
+    }
+
+    if (config->radius < 1 || config->radius > MAX_RADIUS) {
+        return "radius must be from 1 to " LIMIT(MAX_RADIUS);
+    }
+    if (config->kernel < KERNEL_COUNTS || config->kernel > KERNEL_BOX) {
+        return "kernel must be one of the Kernel values";
+    }
+    if (config->radius > 1 && config->kernel != KERNEL_BOX) {
+        return "a radius above 1 needs the box kernel";
+    }
+    if (config->torus && 2 * config->radius + 1 > config->dimensions) {
+        return "a torus must be at least 2 * radius + 1 wide";
+    }
+    if (config->threads < 1 || config->threads > MAX_THREADS) {
+        return "threads must be from 1 to " LIMIT(MAX_THREADS);
+    }
+    if (config->policy < POLICY_FIRST_LAST || config->policy > POLICY_BEST) {
+        return "policy must be one of the MovePolicy values";
+    }
+    if (config->policy == POLICY_BEST && config->kernel != KERNEL_COUNTS) {
+        return "the best policy needs the counts kernel and a radius of 1";
+    }
+    if (config->update < UPDATE_SYNC || config->update > UPDATE_ASYNC) {
+        return "update must be one of the UpdateMode values";
+    }
+    if (config->update == UPDATE_ASYNC && config->kernel != KERNEL_COUNTS) {
+        return "the async update needs the counts kernel and a radius of 1";
+    }
+
+    return NULL;
+}
+
+
+/**
+ * failCreate(): Frees whatever simCreate had set up so far and reports
+ * that memory ran out.
+ */
+static Simulation *failCreate(Simulation *sim, int gameReady,
+                              const char **error) {
+
+    if (gameReady) {
+        freeGame(&sim->game);
+    }
+    if (sim->board != NULL) {
+        freeBoard(sim->config.dimensions, sim->board);
+    }
+    free(sim);
+
+    if (error != NULL) {
+        *error = "not enough memory for the board";
+    }
+    return NULL;
+}
+
+
+/**
+ * simCreate(): Checks the config, then populates and shuffles the board and
+ * sets up the game for it, just as bracetopia does before its first cycle.
+ */
+Simulation *simCreate(const SimConfig *config, const char **error) {
+
+    const char *problem = checkConfig(config);
+
+    if (problem != NULL) {
+        if (error != NULL) {
+            *error = problem;
+        }
+        return NULL;
+    }
+
+    Simulation *sim = malloc(sizeof(Simulation));
+    if (sim == NULL) {
+        if (error != NULL) {
+            *error = "not enough memory for the board";
+        }
+        return NULL;
+    }
+
+    int dimensions = config->dimensions;
+    sim->config = *config;
+    sim->cycle = 0;
+    seedRng(&sim->rng, config->seed);
+    sim->board = allocBoard(dimensions);
+
+    if (sim->board == NULL) {
+        return failCreate(sim, 0, error);
+    }
+
+    char (*board)[dimensions] = (char (*)[dimensions])sim->board;
+
+    populateBoard(dimensions, board, config->vacancy, config->typePercents,
+                  config->numTypes, config->threads);
+    if (!shuffle(dimensions, board, &sim->rng, config->threads)) {
+        return failCreate(sim, 0, error);
+    }
+
+    if (!initGame(&sim->game, dimensions, board, config->numTypes,
+                  config->radius, config->torus, config->kernel,
+                  config->threads)) {
+        return failCreate(sim, 0, error);
+    }
+    if (!setMovePolicy(&sim->game, config->policy, &sim->rng) ||
+        !setUpdateMode(&sim->game, config->update, &sim->rng)) {
+        return failCreate(sim, 1, error);
+    }
+
+    boardStats(&sim->game, dimensions, board, config->strengthThreshold,
+               &sim->stats);
+    sim->stats.moves = 0;
+
+    return sim;
+}
+
+
+/**
+ * simDestroy(): Frees the game, the board, and the handle.
+ */
+void simDestroy(Simulation *sim) {
+
+    if (sim == NULL) {
+        return;
+    }
+
+    freeGame(&sim->game);
+    freeBoard(sim->config.dimensions, sim->board);
+    free(sim);
+}
+
+
+/**
+ * simStep(): Runs gameStep once per cycle, keeping the statistics of the
+ * last one.
+ */
+long simStep(Simulation *sim, int cycles) {
+
+    int dimensions = sim->config.dimensions;
+    char (*board)[dimensions] = (char (*)[dimensions])sim->board;
+    long totalMoves = 0;  // Moves made over all of the cycles
+
+    for (int c = 0; c < cycles; c++) {
+        totalMoves += gameStep(&sim->game, dimensions, board,
+                               sim->config.strengthThreshold, &sim->stats);
+        sim->cycle++;
+    }
+
+    return totalMoves;
+}
+
+
+/**
+ * simStats(): Gives the statistics kept by the last step.
+ */
+const StepStats *simStats(const Simulation *sim) {
+
+    return &sim->stats;
+}
+
+
+/**
+ * simCycle(): Gives the number of cycles stepped.
+ */
+int simCycle(const Simulation *sim) {
+
+    return sim->cycle;
+}
+
+
+/**
+ * simHash(): Gives the hash the game keeps up to date as agents move.
+ */
+uint64_t simHash(const Simulation *sim) {
+
+    return sim->game.hash;
+}
+
+
+/**
+ * simDimensions(): Gives the size the simulation was created with.
+ */
+int simDimensions(const Simulation *sim) {
+
+    return sim->config.dimensions;
+}
+
+
+/**
+ * simBoard(): Gives the board itself, which is already stored a row at a
+ * time with no gaps.
+ */
+const char *simBoard(const Simulation *sim) {
+
+    return sim->board;
+}
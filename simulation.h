@@ -0,0 +1,178 @@
+//
+// File: simulation.h
+// Description: Provides a simulation behind an opaque handle, so another
+// program can set up a board, advance it, and read it back without going
+// through bracetopia's flags or its output. A handle owns its board, its
+// generator, and the state gameMove keeps, and nothing is shared between
+// handles, so any number of simulations can run side by side in one
+// process, each on its own thread. This header, the modules under it, and
+// simulation.c are built into libbracetopia.a and libbracetopia.so by
+// make lib, and the header can be included from C++ as well as C.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for simulation.h
+#ifndef _SIMULATION_H_
+#define _SIMULATION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "agent_types.h"
+#include "game_types.h"
+#include "vacancy_index.h"
+
+
+// Marks the functions libbracetopia.so exports. Its objects are built with
+// hidden visibility, so the modules under the simulation keep their names
+// to themselves and can't clash with those of the program loading it
+#if defined(__GNUC__)
+#define SIM_API __attribute__((visibility("default")))
+#else
+#define SIM_API
+#endif
+
+
+/**
+ * Simulation is a board and everything needed to advance it, only reached
+ * through the functions below.
+ */
+typedef struct Simulation Simulation;
+
+
+/**
+ * SimConfig holds the settings a simulation is created with, the same ones
+ * bracetopia takes as flags. simDefaultConfig fills in its defaults.
+ */
+typedef struct {
+    int dimensions;                // the size of the square board, from 5
+                                   // to MAX_DIMENSIONS
+    int strengthThreshold;         // happiness needed to stay in place, from
+                                   // 1 to 99
+    int vacancy;                   // percentage of the board that is vacant,
+                                   // from 1 to 99
+    int numTypes;                  // types of agents, from 2 to MAX_TYPES
+    int typePercents[MAX_TYPES];   // percentage of the agents of each type,
+                                   // each from 1 to 99 adding up to 100
+    int radius;                    // rows and columns on each side of a cell
+                                   // that are its neighbors, from 1 to
+                                   // MAX_RADIUS, above 1 for KERNEL_BOX only
+    int torus;                     // boolean, true if the board wraps around
+    Kernel kernel;                 // how neighbor counts are found
+    int threads;                   // threads checking the board each cycle,
+                                   // from 1 to MAX_THREADS
+    MovePolicy policy;             // how agents pick the spot they move to
+    UpdateMode update;             // how the agents of a cycle are moved
+    uint64_t seed;                 // seed the board is shuffled with
+} SimConfig;
+
+
+/**
+ * simDefaultConfig fills a config with bracetopia's defaults: a 15x15 board
+ * with 50% strength of preference and 20% vacancies, 60% endline and 40%
+ * newline agents, the 8 neighbors of a bounded board counted by the counts
+ * kernel on one thread, the first and last policy, the sync update, and a
+ * seed of 0.
+ *
+ * @param config  the config to fill
+ */
+SIM_API void simDefaultConfig(SimConfig *config);
+
+
+/**
+ * simCreate sets up a simulation from a config, with its board populated and
+ * shuffled and on cycle 0.
+ *
+ * @param config  the settings to create the simulation with, which are
+ *                copied
+ * @param error   set to a message saying why no simulation was created,
+ *                unless it is NULL, which is left alone on success
+ * @returns       the new simulation, or NULL if the config was invalid or
+ *                memory ran out
+ */
+SIM_API Simulation *simCreate(const SimConfig *config, const char **error);
+
+
+/**
+ * simDestroy frees a simulation and everything it holds, including the
+ * board simBoard gave out.
+ *
+ * @param sim  the simulation to free, or NULL
+ */
+SIM_API void simDestroy(Simulation *sim);
+
+
+/**
+ * simStep advances a simulation by a number of cycles.
+ *
+ * @param sim     the simulation to advance
+ * @param cycles  the number of cycles to run
+ * @returns       the moves made over all of those cycles
+ */
+SIM_API long simStep(Simulation *sim, int cycles);
+
+
+/**
+ * simStats gives the statistics of the board as it is now, with the moves
+ * of the cycle that made it.
+ *
+ * @param sim  the simulation to read
+ * @returns    the statistics, kept by the simulation and changed by the
+ *             next simStep
+ */
+SIM_API const StepStats *simStats(const Simulation *sim);
+
+
+/**
+ * simCycle gives the cycle a simulation is on.
+ *
+ * @param sim  the simulation to read
+ * @returns    the number of cycles run since it was created
+ */
+SIM_API int simCycle(const Simulation *sim);
+
+
+/**
+ * simHash gives a hash of every agent and the cell it is in, which is the
+ * same for two boards that are the same.
+ *
+ * @param sim  the simulation to read
+ * @returns    the hash of the board
+ */
+SIM_API uint64_t simHash(const Simulation *sim);
+
+
+/**
+ * simDimensions gives the size of a simulation's board.
+ *
+ * @param sim  the simulation to read
+ * @returns    the width and height of the board
+ */
+SIM_API int simDimensions(const Simulation *sim);
+
+
+/**
+ * simBoard gives the simulation's own board without copying it, as
+ * dimensions * dimensions chars a row at a time: '.' for a vacant cell and
+ * the chars of AGENT_CHARS for the agents. It is not null terminated.
+ *
+ * @param sim  the simulation to read
+ * @returns    the board, which changes with every simStep and must not be
+ *             written to or used after simDestroy
+ */
+SIM_API const char *simBoard(const Simulation *sim);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+// End include guard
+#endif
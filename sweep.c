@@ -0,0 +1,522 @@
+//
+// File: sweep.c
+// Description: Contains the functions that read the ranges of a sweep and run
+// them on a pool of threads. Every thread starts with its own share of the
+// runs, takes them from the back of its queue, and once it has none left
+// steals from the front of the others' queues.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "sweep.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ensemble.h"
+#include "equilibrium.h"
+#include "init_board.h"
+
+
+/**
+ * RunQueue is the runs, or batches of runs for an ensemble sweep,
+ * [head, tail) still waiting in one thread's queue.
+ */
+typedef struct {
+    pthread_mutex_t lock;    // held while head or tail is changed
+    size_t head;             // next run a thief takes
+    size_t tail;             // one past the next run the owner takes
+} RunQueue;
+
+
+/**
+ * Worker is one thread of the pool and everything it shares with the rest.
+ */
+typedef struct {
+    const Sweep *sweep;          // the sweep being run
+    FILE *out;                   // where rows are written
+    pthread_mutex_t *outLock;    // held while a row is written
+    RunQueue *queues;            // the queue of every worker
+    int numWorkers;              // number of workers and queues
+    int index;                   // the worker's own queue
+    int failed;                  // boolean, true if memory ran out
+    Ensemble ensemble;           // replicas of a batch, if playing batches
+    Equilibrium *equilibria;     // recent boards of each replica of a batch
+    pthread_t thread;            // the thread running the worker
+    int running;                 // 1 while the worker's thread is running
+} Worker;
+
+
+/**
+ * parseRange(): Reads "first", "first:last", or "first:last:step" and
+ * checks that every value is a percentage in [1...99].
+ */
+static int parseRange(const char *text, SweepRange *range) {
+
+    char *end;
+
+    range->first = (int)strtol(text, &end, 10);
+    range->last = range->first;
+    range->step = 1;
+
+    if (end != text && *end == ':') {
+        text = end + 1;
+        range->last = (int)strtol(text, &end, 10);
+
+        if (end != text && *end == ':') {
+            text = end + 1;
+            range->step = (int)strtol(text, &end, 10);
+        }
+    }
+
+    return end != text && *end == '\0' && range->first > 0 &&
+           range->last < 100 && range->first <= range->last &&
+           range->step > 0;
+}
+
+
+/**
+ * rangeCount(): Gives the number of values in a range.
+ */
+static size_t rangeCount(const SweepRange *range) {
+
+    return (range->last - range->first) / range->step + 1;
+}
+
+
+/**
+ * elapsed(): Gives the seconds since the monotonic clock read start.
+ */
+static double elapsed(const struct timespec *start) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+
+/**
+ * parseSweep(): Splits the text at each comma and reads the range after the
+ * '=' of each parameter.
+ */
+int parseSweep(const char *text, Sweep *sweep) {
+
+    char *copy = malloc(strlen(text) + 1);
+    int valid = copy != NULL;  // Boolean, false once something is wrong
+
+    if (!valid) {
+        return 0;
+    }
+    strcpy(copy, text);
+
+    for (char *part = strtok(copy, ","); part != NULL && valid;
+         part = strtok(NULL, ",")) {
+        SweepRange *range = NULL;
+
+        if (part[0] == 's') {
+            range = &sweep->strength;
+        }
+        else if (part[0] == 'v') {
+            range = &sweep->vacancy;
+        }
+        else if (part[0] == 'e') {
+            range = &sweep->endline;
+        }
+
+        valid = range != NULL && part[1] == '=' &&
+                parseRange(part + 2, range);
+    }
+
+    free(copy);
+    return valid;
+}
+
+
+/**
+ * takeRun(): Takes a run from the back of the worker's own queue, or from the
+ * front of another worker's queue if its own is empty. Runs are never added
+ * once the sweep starts, so there is nothing left to do once every queue is
+ * empty.
+ */
+static int takeRun(Worker *worker, size_t *run) {
+
+    for (int k = 0; k < worker->numWorkers; k++) {
+        RunQueue *queue = &worker->queues[(worker->index + k) %
+                                          worker->numWorkers];
+        int found = 0;
+
+        pthread_mutex_lock(&queue->lock);
+        if (queue->head < queue->tail) {
+            *run = k == 0 ? --queue->tail : queue->head++;
+            found = 1;
+        }
+        pthread_mutex_unlock(&queue->lock);
+
+        if (found) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * RunSettings is what a run is played with, worked out from its number.
+ */
+typedef struct {
+    int strength;    // strength of preference
+    int vacancy;     // percentage of vacant cells
+    int endline;     // percentage of endline agents
+    int replica;     // which of the combination's replicas it is
+    uint64_t seed;   // seed of the run's generator
+} RunSettings;
+
+
+/**
+ * runSettings(): Works out the settings of a run. The replicas of a
+ * combination are next to each other, then the endline percentages, then
+ * the vacancies, then the strengths.
+ */
+static void runSettings(const Sweep *sweep, size_t run,
+                        RunSettings *settings) {
+
+    size_t index = run;
+    settings->replica = index % sweep->replicas;
+    index /= sweep->replicas;
+    settings->endline = sweep->endline.first +
+                        index % rangeCount(&sweep->endline) *
+                        sweep->endline.step;
+    index /= rangeCount(&sweep->endline);
+    settings->vacancy = sweep->vacancy.first +
+                        index % rangeCount(&sweep->vacancy) *
+                        sweep->vacancy.step;
+    index /= rangeCount(&sweep->vacancy);
+    settings->strength = sweep->strength.first + index * sweep->strength.step;
+    settings->seed = sweep->seed + run;
+}
+
+
+/**
+ * shuffleRun(): Fills and shuffles the board of a run with its own
+ * generator, so runs never share numbers. Each run only gets one thread,
+ * the pool is what makes it parallel, and sweeps only have endline and
+ * newline agents. Returns 0 if memory ran out.
+ */
+static int shuffleRun(const RunSettings *settings, int dimensions,
+                      char board[dimensions][dimensions]) {
+
+    Rng rng;
+    seedRng(&rng, settings->seed);
+    int typePercents[] = { settings->endline, 100 - settings->endline };
+    populateBoard(dimensions, board, settings->vacancy, typePercents, 2, 1);
+
+    return shuffle(dimensions, board, &rng, 1);
+}
+
+
+/**
+ * writeRow(): Writes the row of a run that has ended, holding the lock so
+ * rows from different threads never mix.
+ */
+static void writeRow(Worker *worker, size_t run, const RunSettings *settings,
+                     int converged, const Equilibrium *equilibrium,
+                     int cycles, double happiness, long totalMoves,
+                     double seconds) {
+
+    const Sweep *sweep = worker->sweep;
+
+    pthread_mutex_lock(worker->outLock);
+    if (sweep->json) {
+        fprintf(worker->out, "{\"run\": %zu, \"dimensions\": %d, "
+                "\"strength\": %d, \"vacancy\": %d, \"endline\": %d, "
+                "\"replica\": %d, \"seed\": %" PRIu64 ", \"converged\": %s, "
+                "\"converged_cycle\": %d, \"period\": %d, \"cycles\": %d, "
+                "\"final_happiness\": %.6f, \"total_moves\": %ld, "
+                "\"wall_seconds\": %.6f}\n", run, sweep->dimensions,
+                settings->strength, settings->vacancy, settings->endline,
+                settings->replica, settings->seed,
+                converged ? "true" : "false",
+                converged ? equilibrium->convergedCycle : -1,
+                equilibrium->period, cycles, happiness, totalMoves, seconds);
+    }
+    else {
+        fprintf(worker->out, "%zu,%d,%d,%d,%d,%d,%" PRIu64 ",%d,%d,%d,%d,"
+                "%.6f,%ld,%.6f\n", run, sweep->dimensions,
+                settings->strength, settings->vacancy, settings->endline,
+                settings->replica, settings->seed, converged,
+                converged ? equilibrium->convergedCycle : -1,
+                equilibrium->period, cycles, happiness, totalMoves, seconds);
+    }
+    pthread_mutex_unlock(worker->outLock);
+}
+
+
+/**
+ * playRun(): Sets up the board for one run, plays it until it repeats or
+ * runs out of cycles, and writes its row. Returns 0 if memory ran out.
+ */
+static int playRun(Worker *worker, size_t run, int dimensions,
+                   char board[dimensions][dimensions]) {
+
+    const Sweep *sweep = worker->sweep;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    RunSettings settings;
+    runSettings(sweep, run, &settings);
+
+    Game game;
+    if (!shuffleRun(&settings, dimensions, board) ||
+        !initGame(&game, dimensions, board, 2, sweep->radius, sweep->torus,
+                  sweep->kernel, 1)) {
+        return 0;
+    }
+
+    Equilibrium equilibrium;
+    initEquilibrium(&equilibrium, game.hash);
+    int converged = 0;  // Boolean, true once the board repeats
+    int cycles = 0;  // Cycles run so far
+    long totalMoves = 0;  // Moves made over all cycles
+
+    StepStats stats;
+    boardStats(&game, dimensions, board, settings.strength, &stats);
+
+    while (!converged && cycles < sweep->maxCycles) {
+        totalMoves += gameStep(&game, dimensions, board, settings.strength,
+                               &stats);
+        cycles++;
+        converged = checkEquilibrium(&equilibrium, game.hash);
+    }
+
+    freeGame(&game);
+
+    writeRow(worker, run, &settings, converged, &equilibrium, cycles,
+             stats.happiness, totalMoves, elapsed(&start));
+
+    return 1;
+}
+
+
+/**
+ * playBatch(): Plays up to ENSEMBLE_MAX_REPLICAS replicas of a combination
+ * in lockstep on the worker's ensemble. A replica drops out of the steps
+ * once its board repeats, and the rest carry on until they repeat too or run
+ * out of cycles. Each replica is then copied back out to find its final
+ * happiness and write its row, with an equal share of the batch's time as
+ * its wall time, so the column means the time per run as it does without
+ * an ensemble. Returns 0 if memory ran out.
+ */
+static int playBatch(Worker *worker, size_t batch, int dimensions,
+                     char board[dimensions][dimensions]) {
+
+    const Sweep *sweep = worker->sweep;
+    Ensemble *ensemble = &worker->ensemble;
+    Equilibrium *equilibria = worker->equilibria;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // Every combination has the same number of batches, the last of which
+    // may be short
+    size_t batches = (sweep->replicas + ENSEMBLE_MAX_REPLICAS - 1) /
+                     ENSEMBLE_MAX_REPLICAS;
+    int firstReplica = batch % batches * ENSEMBLE_MAX_REPLICAS;
+    int numReplicas = sweep->replicas - firstReplica;
+    if (numReplicas > ENSEMBLE_MAX_REPLICAS) {
+        numReplicas = ENSEMBLE_MAX_REPLICAS;
+    }
+    size_t firstRun = batch / batches * sweep->replicas + firstReplica;
+
+    RunSettings settings;  // Only the seed and replica differ in a batch
+    int cycles[ENSEMBLE_MAX_REPLICAS];  // Cycles each replica has run
+    long totalMoves[ENSEMBLE_MAX_REPLICAS];  // Moves over all its cycles
+    long moves[ENSEMBLE_MAX_REPLICAS];  // Moves of the last cycle
+
+    for (int r = 0; r < numReplicas; r++) {
+        runSettings(sweep, firstRun + r, &settings);
+        if (!shuffleRun(&settings, dimensions, board)) {
+            return 0;
+        }
+        ensembleSetBoard(ensemble, r, dimensions, board);
+        initEquilibrium(&equilibria[r], ensemble->hash[r]);
+        cycles[r] = 0;
+        totalMoves[r] = 0;
+    }
+
+    // The replicas whose boards have not repeated yet
+    uint64_t active = numReplicas == ENSEMBLE_MAX_REPLICAS ?
+                      ~(uint64_t)0 : ((uint64_t)1 << numReplicas) - 1;
+
+    for (int cycle = 0; active != 0 && cycle < sweep->maxCycles; cycle++) {
+        ensembleStep(ensemble, settings.strength, active, moves);
+
+        for (uint64_t bits = active; bits != 0; bits &= bits - 1) {
+            int r = __builtin_ctzll(bits);
+
+            totalMoves[r] += moves[r];
+            cycles[r]++;
+            if (checkEquilibrium(&equilibria[r], ensemble->hash[r])) {
+                active &= ~((uint64_t)1 << r);
+            }
+        }
+    }
+
+    double seconds = elapsed(&start) / numReplicas;  // Each replica's share
+
+    for (int r = 0; r < numReplicas; r++) {
+        Game game;
+        StepStats stats;
+
+        runSettings(sweep, firstRun + r, &settings);
+        ensembleGetBoard(ensemble, r, dimensions, board);
+        if (!initGame(&game, dimensions, board, 2, 1, sweep->torus,
+                      KERNEL_COUNTS, 1)) {
+            return 0;
+        }
+        boardStats(&game, dimensions, board, settings.strength, &stats);
+        freeGame(&game);
+
+        writeRow(worker, firstRun + r, &settings, !((active >> r) & 1),
+                 &equilibria[r], cycles[r], stats.happiness, totalMoves[r],
+                 seconds);
+    }
+
+    return 1;
+}
+
+
+/**
+ * runWorker(): Plays runs, or batches of them on an ensemble, on one board
+ * until there are none left in any queue.
+ */
+static void *runWorker(void *arg) {
+
+    Worker *worker = arg;
+    const Sweep *sweep = worker->sweep;
+    int dimensions = sweep->dimensions;
+    char (*board)[dimensions] = allocBoard(dimensions);
+    int replicas = sweep->replicas < ENSEMBLE_MAX_REPLICAS ?
+                   sweep->replicas : ENSEMBLE_MAX_REPLICAS;
+    size_t job;
+
+    if (board == NULL) {
+        worker->failed = 1;
+        return NULL;
+    }
+
+    // An ensemble sweep plays every batch on the same ensemble
+    worker->equilibria = NULL;
+    if (sweep->ensemble) {
+        worker->equilibria = malloc(replicas * sizeof(Equilibrium));
+
+        if (worker->equilibria == NULL ||
+            !initEnsemble(&worker->ensemble, dimensions, sweep->torus,
+                          replicas)) {
+            worker->failed = 1;
+            free(worker->equilibria);
+            freeBoard(dimensions, board);
+            return NULL;
+        }
+    }
+
+    while (takeRun(worker, &job)) {
+        if (sweep->ensemble ? !playBatch(worker, job, dimensions, board) :
+                              !playRun(worker, job, dimensions, board)) {
+            worker->failed = 1;
+            break;
+        }
+    }
+
+    if (sweep->ensemble) {
+        freeEnsemble(&worker->ensemble);
+        free(worker->equilibria);
+    }
+    freeBoard(dimensions, board);
+    return NULL;
+}
+
+
+/**
+ * runSweep(): Splits the runs evenly between the queues, starts a thread for
+ * every worker but the first, which runs on this thread, and waits for all
+ * of them. A worker whose thread couldn't be started has its runs stolen by
+ * the others.
+ */
+int runSweep(const Sweep *sweep, FILE *out) {
+
+    size_t numRuns = rangeCount(&sweep->strength) *
+                     rangeCount(&sweep->vacancy) *
+                     rangeCount(&sweep->endline) * sweep->replicas;
+    int numWorkers = sweep->threads;
+    pthread_mutex_t outLock = PTHREAD_MUTEX_INITIALIZER;
+
+    // An ensemble sweep queues batches of each combination's replicas
+    // instead of single runs
+    size_t numJobs = numRuns;
+    if (sweep->ensemble) {
+        numJobs = numRuns / sweep->replicas *
+                  ((sweep->replicas + ENSEMBLE_MAX_REPLICAS - 1) /
+                   ENSEMBLE_MAX_REPLICAS);
+    }
+
+    // Every worker needs at least one job to start with
+    if ((size_t)numWorkers > numJobs) {
+        numWorkers = numJobs;
+    }
+
+    RunQueue *queues = malloc(numWorkers * sizeof(RunQueue));
+    Worker *workers = calloc(numWorkers, sizeof(Worker));
+
+    if (queues == NULL || workers == NULL) {
+        free(queues);
+        free(workers);
+        return 0;
+    }
+
+    for (int t = 0; t < numWorkers; t++) {
+        pthread_mutex_init(&queues[t].lock, NULL);
+        queues[t].head = numJobs * t / numWorkers;
+        queues[t].tail = numJobs * (t + 1) / numWorkers;
+
+        workers[t].sweep = sweep;
+        workers[t].out = out;
+        workers[t].outLock = &outLock;
+        workers[t].queues = queues;
+        workers[t].numWorkers = numWorkers;
+        workers[t].index = t;
+    }
+
+    if (!sweep->json) {
+        fprintf(out, "run,dimensions,strength,vacancy,endline,replica,seed,"
+                "converged,converged_cycle,period,cycles,final_happiness,"
+                "total_moves,wall_seconds\n");
+    }
+
+    for (int t = 1; t < numWorkers; t++) {
+        workers[t].running = pthread_create(&workers[t].thread, NULL,
+                                            runWorker, &workers[t]) == 0;
+    }
+
+    runWorker(&workers[0]);
+
+    int failed = workers[0].failed;  // Boolean, true if any worker failed
+    for (int t = 1; t < numWorkers; t++) {
+        if (workers[t].running) {
+            pthread_join(workers[t].thread, NULL);
+        }
+        failed |= workers[t].failed;
+    }
+
+    for (int t = 0; t < numWorkers; t++) {
+        pthread_mutex_destroy(&queues[t].lock);
+    }
+    free(queues);
+    free(workers);
+
+    return !failed;
+}
@@ -0,0 +1,94 @@
+//
+// File: sweep.h
+// Description: Provides a sweep mode that runs the simulation for every
+// combination of a range of strengths, vacancies, and endline percentages,
+// several times each with different seeds, all in one process. The runs are
+// shared out between a pool of threads that take work from each other once
+// they run out, and one CSV or JSON row is written for each run as it ends.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for sweep.h
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "play_game.h"
+
+// Cycles a run stops at if the board never repeats and no -c was given
+#define SWEEP_MAX_CYCLES 1000
+
+
+/**
+ * SweepRange is the values from first to last, step apart. A single value
+ * has first and last the same.
+ */
+typedef struct {
+    int first;   // the first value
+    int last;    // the last value, included if step lands on it
+    int step;    // the space between values, at least 1
+} SweepRange;
+
+
+/**
+ * Sweep holds everything about a sweep that is the same for every run.
+ */
+typedef struct {
+    int dimensions;          // the size of the square board of every run
+    int radius;              // neighborhood radius of every run
+    int torus;               // boolean, true if every board wraps around
+    Kernel kernel;           // how neighbor counts are found
+    SweepRange strength;     // strengths of preference to run
+    SweepRange vacancy;      // percentages of vacant cells to run
+    SweepRange endline;      // percentages of endline agents to run
+    int replicas;            // runs of each combination, each its own seed
+    int maxCycles;           // cycles a run stops at if it never repeats
+    int threads;             // threads in the pool
+    int ensemble;            // boolean, true to play replicas in lockstep
+    int json;                // boolean, true for JSON rows instead of CSV
+    uint64_t seed;           // seed of the first run, counting up from it
+} Sweep;
+
+
+/**
+ * parseSweep reads the ranges of a sweep from text like
+ * "s=30:70:10,v=10:30:5,e=60", where each range is a single value, first:last
+ * for every value between, or first:last:step. Parameters left out keep the
+ * range they already had, and every value must be in [1...99].
+ *
+ * @param text   the ranges to read
+ * @param sweep  the sweep to set the ranges of
+ * @returns      1 if the text was valid, 0 otherwise
+ */
+int parseSweep(const char *text, Sweep *sweep);
+
+
+/**
+ * runSweep runs every combination of the sweep's ranges the given number of
+ * times. Each run shuffles a new board with its own seed and runs until the
+ * board repeats or maxCycles cycles have been run, then writes a row with
+ * its settings, seed, the cycle where the board started repeating, the final
+ * happiness, the total moves, and how long it took. Rows are written as
+ * runs end, so they are numbered to tell which run each one is. An
+ * ensemble sweep plays up to ENSEMBLE_MAX_REPLICAS replicas of a combination
+ * at once on a bit-sliced ensemble, which gives the same rows as playing
+ * them one at a time.
+ *
+ * @param sweep  the sweep to run
+ * @param out    where the rows are written
+ * @returns      1 if every run was made, 0 if memory or threads ran out
+ */
+int runSweep(const Sweep *sweep, FILE *out);
+
+
+// End include guard
+#endif
@@ -0,0 +1,245 @@
+//
+// File: test_kernels.c
+// Description: Checks that every kernel plays the same game, on one thread or
+// several. Boards of a few sizes, numbers of types, and edges are shuffled
+// with fixed seeds and played with KERNEL_COUNTS on one thread, and the same
+// boards are played alongside with each of the other kernels on one thread
+// and with every kernel on TEST_THREADS threads. After every cycle each
+// board, the moves made, and the happiness of the board must match the
+// serial KERNEL_COUNTS game exactly. The boards wide enough for whole
+// groups of 256 cells also check the AVX2 adds of KERNEL_PACKED against the
+// rest when the CPU has AVX2. make check runs it.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "agent_types.h"
+#include "init_board.h"
+#include "play_game.h"
+
+
+// Strength of preference and vacancy of the boards checked, which leave
+// agents unhappy for many cycles
+#define TEST_STRENGTH 60
+#define TEST_VACANCY 20
+
+// Cycles run for each board
+#define TEST_CYCLES 20
+
+// Seeds the boards are shuffled with
+static const int testSeeds[] = {1, 2, 3};
+
+// Threads the bands of the parallel games are checked on
+#define TEST_THREADS 4
+
+// Kernels played, and their names for the messages
+static const Kernel testKernels[] = {KERNEL_COUNTS, KERNEL_CHAR, KERNEL_PACKED,
+                                     KERNEL_BOX};
+static const char *kernelNames[] = {"counts", "char", "packed", "box"};
+
+#define NUM_ITEMS(array) ((int)(sizeof(array) / sizeof((array)[0])))
+
+
+/**
+ * TestBoard is a board checked with every kernel.
+ */
+typedef struct {
+    int dimensions;           // the size of the board
+    int numTypes;             // the types of agents in it
+    int typePercents[3];      // the percentage of the agents of each type
+    int torus;                // boolean, true if the board wraps around
+} TestBoard;
+
+// Boards checked, the widest of which has a group of 256 cells in each row
+static const TestBoard testBoards[] = {
+    {40, 2, {60, 40, 0}, 0},
+    {40, 3, {50, 30, 20}, 1},
+    {300, 2, {60, 40, 0}, 0},
+    {300, 3, {50, 30, 20}, 1}
+};
+
+
+/**
+ * Player is one kernel playing a board on some number of threads.
+ */
+typedef struct {
+    int kernel;               // the index of the kernel in testKernels
+    int threads;              // the threads the game checks its bands on
+    char *board;              // the board the kernel plays
+    Game game;                // the state kept between its cycles
+    int ready;                // boolean, true once game has been set up
+} Player;
+
+
+/**
+ * startPlayer sets up a kernel to play a copy of a board.
+ *
+ * @param player  the player to set up
+ * @param test    the board being checked
+ * @param start   the shuffled board to start from, played with the kernel
+ *                and threads already set in player
+ * @returns       1 if it was set up, 0 if memory ran out
+ */
+static int startPlayer(Player *player, const TestBoard *test,
+                       const char *start) {
+
+    int dimensions = test->dimensions;
+
+    player->ready = 0;
+    player->board = allocBoard(dimensions);
+    if (player->board == NULL) {
+        return 0;
+    }
+
+    memcpy(player->board, start, (size_t)dimensions * dimensions);
+    player->ready = initGame(&player->game, dimensions,
+                             (char (*)[dimensions])player->board,
+                             test->numTypes, 1, test->torus,
+                             testKernels[player->kernel], player->threads);
+    return player->ready;
+}
+
+
+/**
+ * stopPlayer frees what a player was set up with.
+ *
+ * @param player  the player to free
+ * @param test    the board it was playing
+ */
+static void stopPlayer(Player *player, const TestBoard *test) {
+
+    if (player->ready) {
+        freeGame(&player->game);
+    }
+    if (player->board != NULL) {
+        freeBoard(test->dimensions, player->board);
+    }
+}
+
+
+/**
+ * checkBoard plays a board shuffled with a seed with KERNEL_COUNTS on one
+ * thread, and with the other kernels on one thread and every kernel on
+ * TEST_THREADS, for TEST_CYCLES cycles, comparing them after every cycle.
+ *
+ * @param test  the board to check
+ * @param seed  the seed to shuffle it with
+ * @returns     1 if every kernel matched every cycle, 0 otherwise
+ */
+static int checkBoard(const TestBoard *test, int seed) {
+
+    int dimensions = test->dimensions;
+    size_t totalSpaces = (size_t)dimensions * dimensions;
+    char (*start)[dimensions] = allocBoard(dimensions);
+    Player reference = {0, 1, NULL, {0}, 0};
+    Player players[2 * NUM_ITEMS(testKernels) - 1];
+    int numPlayers = 0;
+    Rng rng;
+    int ok = start != NULL;
+
+    for (int k = 0; k < NUM_ITEMS(testKernels); k++) {
+        for (int threads = 1; threads <= TEST_THREADS;
+             threads += TEST_THREADS - 1) {
+            if (k == reference.kernel && threads == reference.threads) {
+                continue;
+            }
+            players[numPlayers].kernel = k;
+            players[numPlayers].threads = threads;
+            players[numPlayers].board = NULL;
+            players[numPlayers].ready = 0;
+            numPlayers++;
+        }
+    }
+
+    if (ok) {
+        int typePercents[3];
+
+        memcpy(typePercents, test->typePercents, sizeof(typePercents));
+        seedRng(&rng, seed);
+        populateBoard(dimensions, start, TEST_VACANCY, typePercents,
+                      test->numTypes, 1);
+        ok = shuffle(dimensions, start, &rng, 1) &&
+             startPlayer(&reference, test, (char *)start);
+    }
+    for (int p = 0; ok && p < numPlayers; p++) {
+        ok = startPlayer(&players[p], test, (char *)start);
+    }
+    if (!ok) {
+        fprintf(stderr, "test_kernels: not enough memory\n");
+    }
+
+    for (int cycle = 1; ok && cycle <= TEST_CYCLES; cycle++) {
+        long moves = gameMove(&reference.game, dimensions,
+                              (char (*)[dimensions])reference.board,
+                              TEST_STRENGTH);
+        double happiness = getBoardHappiness(&reference.game, dimensions,
+                               (char (*)[dimensions])reference.board, NULL);
+
+        for (int p = 0; ok && p < numPlayers; p++) {
+            Player *player = &players[p];
+            char (*board)[dimensions] = (char (*)[dimensions])player->board;
+            long playerMoves = gameMove(&player->game, dimensions, board,
+                                        TEST_STRENGTH);
+            double playerHappiness = getBoardHappiness(&player->game,
+                                                       dimensions, board,
+                                                       NULL);
+            int differ = memcmp(player->board, reference.board,
+                                totalSpaces) != 0;
+
+            if (playerMoves != moves || playerHappiness != happiness ||
+                differ) {
+                fprintf(stderr, "test_kernels: d%d, %d types, seed %d, "
+                        "cycle %d, %s on %d threads makes %ld moves for "
+                        "happiness %f, counts on 1 makes %ld for %f%s\n",
+                        dimensions, test->numTypes, seed, cycle,
+                        kernelNames[player->kernel], player->threads,
+                        playerMoves, playerHappiness, moves, happiness,
+                        differ ? ", and the boards differ" : "");
+                ok = 0;
+            }
+        }
+    }
+
+    for (int p = 0; p < numPlayers; p++) {
+        stopPlayer(&players[p], test);
+    }
+    stopPlayer(&reference, test);
+    if (start != NULL) {
+        freeBoard(dimensions, start);
+    }
+    return ok;
+}
+
+
+/**
+ * main checks every board with every seed.
+ *
+ * @returns  EXIT_SUCCESS if every kernel matched, EXIT_FAILURE otherwise
+ */
+int main(void) {
+
+    int ok = 1;
+
+    for (int b = 0; b < NUM_ITEMS(testBoards); b++) {
+        const TestBoard *test = &testBoards[b];
+        int boardOk = 1;
+
+        for (int s = 0; s < NUM_ITEMS(testSeeds); s++) {
+            boardOk = checkBoard(test, testSeeds[s]) && boardOk;
+        }
+
+        printf("d%d, %d types%s: %s\n", test->dimensions, test->numTypes,
+               test->torus ? ", torus" : "", boardOk ? "ok" : "FAILED");
+        ok = ok && boardOk;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
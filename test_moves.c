@@ -0,0 +1,174 @@
+//
+// File: test_moves.c
+// Description: Checks that the moves gameMove records are enough to rebuild
+// the board it leaves, which is what the viewport relies on to redraw only
+// the blocks that changed. A copy of the board is kept, every move of a
+// cycle is replayed on it in order, and it must match the board afterwards.
+// With UPDATE_ASYNC an agent can move into a cell and out again in the same
+// cycle, so the cycles are also checked for such chained moves, and it
+// fails if none were made since then the test proved nothing. make check
+// runs it.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "agent_types.h"
+#include "init_board.h"
+#include "play_game.h"
+
+
+// Size, strength of preference, and vacancy of the boards checked, which
+// leave agents unhappy for many cycles
+#define TEST_DIMENSIONS 40
+#define TEST_STRENGTH 60
+#define TEST_VACANCY 20
+
+// Cycles run for each update
+#define TEST_CYCLES 50
+
+// Seed the boards are shuffled with
+#define TEST_SEED 1
+
+
+/**
+ * replayMoves applies the moves of the last cycle to a copy of the board
+ * from before it, checking each one starts from the agent it says moved and
+ * ends in a vacant cell.
+ *
+ * @param game    the state kept between cycles, with the moves of the cycle
+ * @param copy    the board from before the cycle, which is updated
+ * @param chains  counted up for every move out of a cell moved into earlier
+ *                in the cycle
+ * @returns       1 if every move could be replayed, 0 otherwise
+ */
+static int replayMoves(const Game *game, char *copy, size_t *chains) {
+
+    size_t totalSpaces = (size_t)game->dimensions * game->dimensions;
+    char *movedInto = calloc(totalSpaces, 1);  // Cells moved into so far
+
+    if (movedInto == NULL) {
+        fprintf(stderr, "test_moves: not enough memory\n");
+        return 0;
+    }
+
+    for (size_t m = 0; m < game->numMoves; m++) {
+        size_t from = game->moveFrom[m];
+        size_t to = game->moveTo[m];
+
+        if (copy[from] != game->moveAgent[m] || copy[to] != '.') {
+            fprintf(stderr, "test_moves: move %zu of %zu, '%c' from %zu to "
+                    "%zu, finds '%c' and '%c' there\n", m, game->numMoves,
+                    game->moveAgent[m], from, to, copy[from], copy[to]);
+            free(movedInto);
+            return 0;
+        }
+
+        *chains += movedInto[from];
+        movedInto[to] = 1;
+        copy[from] = '.';
+        copy[to] = game->moveAgent[m];
+    }
+
+    free(movedInto);
+    return 1;
+}
+
+
+/**
+ * checkUpdate runs a game with an update for TEST_CYCLES cycles, replaying
+ * the moves of each cycle on a copy of the board and comparing the two.
+ *
+ * @param mode    the update to check
+ * @param name    the name of the update, for the messages
+ * @param chains  set to the number of chained moves made
+ * @returns       1 if the copy matched the board after every cycle, 0
+ *                otherwise
+ */
+static int checkUpdate(UpdateMode mode, const char *name, size_t *chains) {
+
+    int dimensions = TEST_DIMENSIONS;
+    size_t totalSpaces = (size_t)dimensions * dimensions;
+    int typePercents[2] = {60, 40};
+    char (*board)[dimensions] = allocBoard(dimensions);
+    char *copy = malloc(totalSpaces);
+    Game game;
+    Rng rng;
+    int ok = 1;
+
+    *chains = 0;
+    seedRng(&rng, TEST_SEED);
+
+    if (board == NULL || copy == NULL) {
+        fprintf(stderr, "test_moves: not enough memory\n");
+        free(copy);
+        if (board != NULL) {
+            freeBoard(dimensions, board);
+        }
+        return 0;
+    }
+
+    populateBoard(dimensions, board, TEST_VACANCY, typePercents, 2, 1);
+    if (!shuffle(dimensions, board, &rng, 1) ||
+        !initGame(&game, dimensions, board, 2, 1, 0, KERNEL_COUNTS, 1)) {
+        fprintf(stderr, "test_moves: not enough memory\n");
+        free(copy);
+        freeBoard(dimensions, board);
+        return 0;
+    }
+
+    if (!setUpdateMode(&game, mode, &rng)) {
+        fprintf(stderr, "test_moves: not enough memory\n");
+        ok = 0;
+    }
+
+    for (int cycle = 1; ok && cycle <= TEST_CYCLES; cycle++) {
+        memcpy(copy, board, totalSpaces);
+        gameMove(&game, dimensions, board, TEST_STRENGTH);
+
+        ok = replayMoves(&game, copy, chains);
+        if (ok && memcmp(copy, board, totalSpaces) != 0) {
+            fprintf(stderr, "test_moves: %s cycle %d, replaying the moves "
+                    "gives a different board\n", name, cycle);
+            ok = 0;
+        }
+    }
+
+    printf("%s: %s, %zu chained moves\n", name, ok ? "ok" : "FAILED",
+           *chains);
+
+    freeGame(&game);
+    free(copy);
+    freeBoard(dimensions, board);
+    return ok;
+}
+
+
+/**
+ * main checks the sync and async updates.
+ *
+ * @returns  EXIT_SUCCESS if both passed, EXIT_FAILURE otherwise
+ */
+int main(void) {
+
+    size_t syncChains;
+    size_t asyncChains;
+    int ok = checkUpdate(UPDATE_SYNC, "sync", &syncChains);
+
+    ok = checkUpdate(UPDATE_ASYNC, "async", &asyncChains) && ok;
+
+    if (ok && asyncChains == 0) {
+        fprintf(stderr, "test_moves: the async update made no chained "
+                "moves, so they were not checked\n");
+        ok = 0;
+    }
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,464 @@
+//
+// File: vacancy_index.c
+// Description: Contains the functions for the move policies and their
+// indexes. The nearest policy searches down the tiers of blocks from the
+// one covering the board, going into the blocks nearest the agent first and
+// skipping those with no vacancies, and stops going into blocks once none
+// left can hold a cell closer than the best one found.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "vacancy_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "play_game.h"
+
+
+/**
+ * findLevels(): Gives every pair of neighbor counts the rank of its
+ * happiness among all of the different happiness values, so a higher level
+ * is always a happier spot.
+ */
+static void findLevels(VacancyIndex *index) {
+
+    double values[45];  // Happiness of every [total][same], same <= total
+    int numValues = 0;
+
+    for (int total = 0; total <= 8; total++) {
+        for (int same = 0; same <= total; same++) {
+            values[numValues++] = happinessFromCounts(same, total);
+        }
+    }
+
+    index->numLevels = 0;
+    for (int total = 0; total <= 8; total++) {
+        for (int same = 0; same <= 8; same++) {
+            if (same > total) {
+                index->levelOf[total][same] = NO_LEVEL;
+                continue;
+            }
+
+            double happiness = happinessFromCounts(same, total);
+            int level = 0;  // Different values below this one
+
+            for (int v = 0; v < numValues; v++) {
+                int counted = 0;  // Boolean, true if seen before in values
+
+                for (int u = 0; u < v && !counted; u++) {
+                    counted = values[u] == values[v];
+                }
+                if (!counted && values[v] < happiness) {
+                    level++;
+                }
+            }
+
+            index->levelOf[total][same] = level;
+            if (level + 1 > index->numLevels) {
+                index->numLevels = level + 1;
+            }
+        }
+    }
+}
+
+
+/**
+ * initVacancyIndex(): Allocates only what the policy uses, then adds every
+ * vacant cell to it.
+ */
+int initVacancyIndex(VacancyIndex *index, MovePolicy policy, int dimensions,
+                     int torus, int numTypes, const CellSet *vacancies,
+                     Rng *rng) {
+
+    size_t totalSpaces = (size_t)dimensions * dimensions;
+
+    memset(index, 0, sizeof(*index));
+    index->policy = policy;
+    index->dimensions = dimensions;
+    index->torus = torus;
+    index->numTypes = numTypes;
+    index->rng = rng;
+
+    if (policy == POLICY_RANDOM) {
+        if (!initWorkList(&index->spots, totalSpaces)) {
+            freeVacancyIndex(index);
+            return 0;
+        }
+    }
+    else if (policy == POLICY_NEAREST) {
+        int size = VACANCY_BLOCK;  // Rows and columns in a block of the tier
+
+        do {
+            int tier = index->numTiers++;
+            int blocks = (dimensions + size - 1) / size;
+
+            index->blockSize[tier] = size;
+            index->blocksPerSide[tier] = blocks;
+            index->blockVacant[tier] = calloc((size_t)blocks * blocks,
+                                              sizeof(int));
+
+            if (index->blockVacant[tier] == NULL) {
+                freeVacancyIndex(index);
+                return 0;
+            }
+            size *= VACANCY_BLOCK;
+        } while (index->blocksPerSide[index->numTiers - 1] > 1);
+    }
+    else if (policy == POLICY_BEST) {
+        findLevels(index);
+        index->levels = malloc(totalSpaces * numTypes);
+        index->levelSets = calloc((size_t)numTypes * index->numLevels,
+                                  sizeof(CellSet));
+
+        if (index->levels == NULL || index->levelSets == NULL) {
+            freeVacancyIndex(index);
+            return 0;
+        }
+        memset(index->levels, NO_LEVEL, totalSpaces * numTypes);
+
+        for (int s = 0; s < numTypes * index->numLevels; s++) {
+            if (!initCellSet(&index->levelSets[s], totalSpaces)) {
+                freeVacancyIndex(index);
+                return 0;
+            }
+        }
+    }
+
+    for (long cell = cellSetFirst(vacancies); cell >= 0;
+         cell = cellSetNext(vacancies, cell + 1)) {
+        vacancyAdded(index, cell);
+    }
+
+    return 1;
+}
+
+
+/**
+ * freeVacancyIndex(): Frees whatever the policy allocated.
+ */
+void freeVacancyIndex(VacancyIndex *index) {
+
+    if (index->levelSets != NULL) {
+        for (int s = 0; s < index->numTypes * index->numLevels; s++) {
+            freeCellSet(&index->levelSets[s]);
+        }
+    }
+
+    freeWorkList(&index->spots);
+    for (int tier = 0; tier < index->numTiers; tier++) {
+        free(index->blockVacant[tier]);
+        index->blockVacant[tier] = NULL;
+    }
+    free(index->levels);
+    free(index->levelSets);
+
+    index->numTiers = 0;
+    index->levels = NULL;
+    index->levelSets = NULL;
+}
+
+
+/**
+ * countVacancy(): Adds change to the count of every block the cell is in,
+ * one in each tier of the nearest policy's index.
+ */
+static void countVacancy(VacancyIndex *index, size_t cell, int change) {
+
+    int row = cell / index->dimensions;
+    int col = cell % index->dimensions;
+
+    for (int tier = 0; tier < index->numTiers; tier++) {
+        int size = index->blockSize[tier];
+
+        index->blockVacant[tier][(size_t)(row / size) *
+                                 index->blocksPerSide[tier] +
+                                 col / size] += change;
+    }
+}
+
+
+/**
+ * vacancyAdded(): Puts the cell at the end of the random policy's array, or
+ * counts it in its blocks for the nearest policy. The best policy waits for
+ * the cell to be scored.
+ */
+void vacancyAdded(VacancyIndex *index, size_t cell) {
+
+    if (index->policy == POLICY_RANDOM) {
+        workListInsert(&index->spots, cell);
+    }
+    else if (index->policy == POLICY_NEAREST) {
+        countVacancy(index, cell, 1);
+    }
+}
+
+
+/**
+ * vacancyTaken(): Takes the cell out of the random policy's array or its
+ * blocks' counts, or out of the best policy's sets.
+ */
+void vacancyTaken(VacancyIndex *index, size_t cell) {
+
+    if (index->policy == POLICY_RANDOM) {
+        workListRemove(&index->spots, cell);
+    }
+    else if (index->policy == POLICY_NEAREST) {
+        countVacancy(index, cell, -1);
+    }
+    else if (index->policy == POLICY_BEST) {
+        size_t totalSpaces = (size_t)index->dimensions * index->dimensions;
+
+        for (int k = 0; k < index->numTypes; k++) {
+            uint8_t *level = &index->levels[k * totalSpaces + cell];
+
+            if (*level != NO_LEVEL) {
+                cellSetRemove(&index->levelSets[k * index->numLevels +
+                                                *level], cell);
+                *level = NO_LEVEL;
+            }
+        }
+    }
+}
+
+
+/**
+ * orderVacancies(): Empties the random policy's array and adds the vacant
+ * cells back in row order.
+ */
+void orderVacancies(VacancyIndex *index, const CellSet *vacancies) {
+
+    if (index->policy != POLICY_RANDOM) {
+        return;
+    }
+
+    clearWorkList(&index->spots);
+    for (long cell = cellSetFirst(vacancies); cell >= 0;
+         cell = cellSetNext(vacancies, cell + 1)) {
+        workListInsert(&index->spots, cell);
+    }
+}
+
+
+/**
+ * vacancyScore(): Moves the cell to the set of its new level for each type
+ * whose level changed.
+ */
+void vacancyScore(VacancyIndex *index, size_t cell, const int same[],
+                  int total) {
+
+    size_t totalSpaces = (size_t)index->dimensions * index->dimensions;
+
+    for (int k = 0; k < index->numTypes; k++) {
+        uint8_t *level = &index->levels[k * totalSpaces + cell];
+        uint8_t newLevel = index->levelOf[total][same[k]];
+
+        if (*level == newLevel) {
+            continue;
+        }
+        if (*level != NO_LEVEL) {
+            cellSetRemove(&index->levelSets[k * index->numLevels + *level],
+                          cell);
+        }
+        cellSetInsert(&index->levelSets[k * index->numLevels + newLevel],
+                      cell);
+        *level = newLevel;
+    }
+}
+
+
+/**
+ * axisDistance(): Gives the distance between two rows or two columns, the
+ * short way around on a torus.
+ */
+static int axisDistance(const VacancyIndex *index, int a, int b) {
+
+    int distance = a > b ? a - b : b - a;
+
+    if (index->torus && index->dimensions - distance < distance) {
+        distance = index->dimensions - distance;
+    }
+
+    return distance;
+}
+
+
+/**
+ * NearestSearch is the state of one search of the nearest policy.
+ */
+typedef struct {
+    const VacancyIndex *index;   // the index being searched
+    const CellSet *vacancies;    // the vacant cells that can be moved into
+    int row;                     // the row of the agent
+    int col;                     // the column of the agent
+    long best;                   // the closest vacant cell so far, or -1
+    long bestDistance;           // its squared distance from the agent
+} NearestSearch;
+
+
+/**
+ * spanDistance(): Gives the distance from a row or column to the closest one
+ * in [low, high], the short way around on a torus.
+ */
+static int spanDistance(const VacancyIndex *index, int low, int high, int a) {
+
+    if (a >= low && a <= high) {
+        return 0;
+    }
+
+    int toLow = axisDistance(index, low, a);
+    int toHigh = axisDistance(index, high, a);
+
+    return toLow < toHigh ? toLow : toHigh;
+}
+
+
+/**
+ * searchBlock(): Looks for a closer vacant cell in a block of a tier. A
+ * block of the first tier has its cells checked. Any other has the blocks
+ * of the tier below it that have vacancies sorted by how close they could
+ * be, and is searched in that order until the next could only hold a
+ * farther cell than the best one found. Blocks as close as the best cell
+ * are still searched, since a lower cell in them wins a tie.
+ */
+static void searchBlock(NearestSearch *search, int tier, int blockRow,
+                        int blockCol) {
+
+    const VacancyIndex *index = search->index;
+    int dimensions = index->dimensions;
+    int size = index->blockSize[tier];
+    int firstRow = blockRow * size;
+    int firstCol = blockCol * size;
+    int lastRow = firstRow + size < dimensions ? firstRow + size : dimensions;
+    int lastCol = firstCol + size < dimensions ? firstCol + size : dimensions;
+
+    if (tier == 0) {
+        for (int i = firstRow; i < lastRow; i++) {
+            for (int j = firstCol; j < lastCol; j++) {
+                size_t spot = (size_t)i * dimensions + j;
+
+                if (!cellSetContains(search->vacancies, spot)) {
+                    continue;
+                }
+
+                long dr = axisDistance(index, i, search->row);
+                long dc = axisDistance(index, j, search->col);
+                long distance = dr * dr + dc * dc;
+
+                if (search->best < 0 || distance < search->bestDistance ||
+                    (distance == search->bestDistance &&
+                     (long)spot < search->best)) {
+                    search->best = spot;
+                    search->bestDistance = distance;
+                }
+            }
+        }
+        return;
+    }
+
+    int below = tier - 1;
+    int childSize = index->blockSize[below];
+    int childBlocks = index->blocksPerSide[below];
+    long distances[VACANCY_BLOCK * VACANCY_BLOCK];  // Closest each could be
+    int children[VACANCY_BLOCK * VACANCY_BLOCK];    // Index of each block
+    int numChildren = 0;
+
+    // Sort the blocks below with vacancies by distance as they are found
+    for (int bi = firstRow / childSize; bi * childSize < lastRow; bi++) {
+        for (int bj = firstCol / childSize; bj * childSize < lastCol; bj++) {
+            if (index->blockVacant[below][bi * childBlocks + bj] == 0) {
+                continue;
+            }
+
+            int lastChildRow = (bi + 1) * childSize - 1;
+            int lastChildCol = (bj + 1) * childSize - 1;
+            lastChildRow = lastChildRow < dimensions ? lastChildRow :
+                           dimensions - 1;
+            lastChildCol = lastChildCol < dimensions ? lastChildCol :
+                           dimensions - 1;
+
+            long dr = spanDistance(index, bi * childSize, lastChildRow,
+                                   search->row);
+            long dc = spanDistance(index, bj * childSize, lastChildCol,
+                                   search->col);
+            long distance = dr * dr + dc * dc;
+            int c = numChildren++;
+
+            while (c > 0 && distances[c - 1] > distance) {
+                distances[c] = distances[c - 1];
+                children[c] = children[c - 1];
+                c--;
+            }
+            distances[c] = distance;
+            children[c] = bi * childBlocks + bj;
+        }
+    }
+
+    for (int c = 0; c < numChildren; c++) {
+        if (search->best >= 0 && distances[c] > search->bestDistance) {
+            break;
+        }
+        searchBlock(search, below, children[c] / childBlocks,
+                    children[c] % childBlocks);
+    }
+}
+
+
+/**
+ * nearestVacancy(): Searches down from the block of the last tier, which
+ * covers the whole board, for the vacant cell with the smallest squared
+ * distance, taking the lowest cell of any that are tied.
+ */
+static long nearestVacancy(const VacancyIndex *index,
+                           const CellSet *vacancies, size_t cell) {
+
+    NearestSearch search;
+
+    search.index = index;
+    search.vacancies = vacancies;
+    search.row = cell / index->dimensions;
+    search.col = cell % index->dimensions;
+    search.best = -1;
+    search.bestDistance = 0;
+
+    if (index->blockVacant[index->numTiers - 1][0] > 0) {
+        searchBlock(&search, index->numTiers - 1, 0, 0);
+    }
+
+    return search.best;
+}
+
+
+/**
+ * pickVacancy(): Looks the spot up in whichever index the policy keeps.
+ */
+long pickVacancy(VacancyIndex *index, const CellSet *vacancies, size_t cell,
+                 int type, int first) {
+
+    switch (index->policy) {
+
+    case POLICY_RANDOM:
+        return index->spots.count > 0 ?
+               (long)workListPick(&index->spots, index->rng) : -1;
+
+    case POLICY_NEAREST:
+        return nearestVacancy(index, vacancies, cell);
+
+    case POLICY_BEST:
+        for (int level = index->numLevels - 1; level >= 0; level--) {
+            long spot = cellSetFirst(&index->levelSets[type *
+                                                       index->numLevels +
+                                                       level]);
+            if (spot >= 0) {
+                return spot;
+            }
+        }
+        return -1;
+
+    default:
+        return first ? cellSetFirst(vacancies) : cellSetLast(vacancies);
+    }
+}
@@ -0,0 +1,179 @@
+//
+// File: vacancy_index.h
+// Description: Provides the move policies that pick the vacant spot an
+// unhappy agent moves to, and the indexes they keep alongside the game's set
+// of vacancies. The first and last policy needs nothing more than the set.
+// The random policy keeps the vacancies packed in an array, each knowing its
+// slot, so one is drawn straight from the array. The array is put back in
+// row order at the start of every cycle, so the spots drawn only depend on
+// the board and the generator and a resumed game draws the same ones. The
+// nearest policy keeps the number of vacancies in each block of the board,
+// and in each block of blocks, and so on up to a single block covering the
+// whole board, so the search can skip any block with none in it however
+// few vacancies are left. The best policy keeps a set of vacancies for
+// every happiness an agent of each type would have there, so the best one
+// is the first cell of the highest set that isn't empty.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for vacancy_index.h
+#ifndef _VACANCY_INDEX_H_
+#define _VACANCY_INDEX_H_
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "agent_types.h"
+#include "cell_set.h"
+#include "rng.h"
+#include "work_list.h"
+
+
+// Rows and columns in a block of the nearest policy's index, and blocks
+// across a block of the tier above
+#define VACANCY_BLOCK 8
+
+// Most tiers of blocks the nearest policy's index can have, enough for a
+// block of the last one to cover MAX_DIMENSIONS
+#define VACANCY_TIERS 8
+
+// Level of a cell that is in none of the best policy's sets
+#define NO_LEVEL 255
+
+
+/**
+ * MovePolicy picks where an unhappy agent moves. POLICY_FIRST_LAST takes the
+ * last vacant spot in row order, then the first, and so on. POLICY_RANDOM
+ * takes any vacant spot, each equally likely. POLICY_NEAREST takes the one
+ * closest to the agent, and POLICY_BEST the one where the agent would be
+ * happiest, both taking the lowest cell of any that are tied.
+ */
+typedef enum {
+    POLICY_FIRST_LAST,
+    POLICY_RANDOM,
+    POLICY_NEAREST,
+    POLICY_BEST
+} MovePolicy;
+
+
+/**
+ * VacancyIndex holds whatever the policy needs on top of the set of vacant
+ * cells. Only the fields of its own policy are allocated.
+ */
+typedef struct {
+    MovePolicy policy;        // the policy the index is for
+    int dimensions;           // the size of the square board
+    int torus;                // boolean, true if the board wraps around
+    int numTypes;             // types of agents in the board
+    Rng *rng;                 // generator the random policy draws from
+    WorkList spots;           // random: the vacant cells, packed
+    int numTiers;             // nearest: tiers of blocks, the last one
+                              // block
+    int blockSize[VACANCY_TIERS];      // nearest: rows and columns in a
+                                       // block of each tier
+    int blocksPerSide[VACANCY_TIERS];  // nearest: blocks across the board in
+                                       // each tier
+    int *blockVacant[VACANCY_TIERS];   // nearest: vacant cells in each block
+                                       // of each tier
+    int numLevels;            // best: different happiness values
+    uint8_t levelOf[9][9];    // best: level of each [total][same]
+    uint8_t *levels;          // best: level of each type at each cell
+    CellSet *levelSets;       // best: vacant cells at each level of each type
+} VacancyIndex;
+
+
+/**
+ * initVacancyIndex allocates the index of a policy and fills it with the
+ * vacant cells. The best policy's cells start at no level until they are
+ * scored with vacancyScore.
+ *
+ * @param index       the index to initialize
+ * @param policy      the policy the index is for
+ * @param dimensions  the size of the square board
+ * @param torus       1 if the board wraps around, 0 if it doesn't
+ * @param numTypes    the number of types of agents, from 2 to MAX_TYPES
+ * @param vacancies   the vacant cells of the board
+ * @param rng         the generator the random policy draws from, which may
+ *                    be NULL for the other policies
+ * @returns           1 if the index was set up, 0 if memory ran out
+ */
+int initVacancyIndex(VacancyIndex *index, MovePolicy policy, int dimensions,
+                     int torus, int numTypes, const CellSet *vacancies,
+                     Rng *rng);
+
+
+/**
+ * freeVacancyIndex releases the memory held by an index.
+ *
+ * @param index  the index to free
+ */
+void freeVacancyIndex(VacancyIndex *index);
+
+
+/**
+ * vacancyAdded adds a cell that just became vacant to the index.
+ *
+ * @param index  the index to add to
+ * @param cell   the cell that is now vacant
+ */
+void vacancyAdded(VacancyIndex *index, size_t cell);
+
+
+/**
+ * vacancyTaken removes a cell that was just moved into from the index.
+ *
+ * @param index  the index to remove from
+ * @param cell   the cell that is no longer vacant
+ */
+void vacancyTaken(VacancyIndex *index, size_t cell);
+
+
+/**
+ * orderVacancies puts the random policy's vacancies back in row order before
+ * a cycle, so the same board always gives the same draws, in time
+ * proportional to the number of vacancies. The other policies keep nothing
+ * that depends on order.
+ *
+ * @param index      the index to reorder
+ * @param vacancies  the vacant cells of the board
+ */
+void orderVacancies(VacancyIndex *index, const CellSet *vacancies);
+
+
+/**
+ * vacancyScore sets the levels of a vacant cell for the best policy from the
+ * neighbors around it.
+ *
+ * @param index  the index of the best policy
+ * @param cell   a vacant cell
+ * @param same   the neighbors of each type around the cell
+ * @param total  the non-vacant neighbors around the cell
+ */
+void vacancyScore(VacancyIndex *index, size_t cell, const int same[],
+                  int total);
+
+
+/**
+ * pickVacancy finds the spot an agent moves to under the index's policy.
+ *
+ * @param index      the index of the policy
+ * @param vacancies  the vacant cells that can still be moved into
+ * @param cell       the cell of the agent that moves
+ * @param type       the type of the agent
+ * @param first      for POLICY_FIRST_LAST, 1 for the first vacant cell and
+ *                   0 for the last
+ * @returns          the cell to move to, or -1 if there is none
+ */
+long pickVacancy(VacancyIndex *index, const CellSet *vacancies, size_t cell,
+                 int type, int first);
+
+
+// End include guard
+#endif
@@ -0,0 +1,324 @@
+//
+// File: viewport.c
+// Description: Contains the functions that move the view around the board,
+// count the chars in each block on screen, and draw the blocks with curses.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "viewport.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ncurses.h>
+
+
+/**
+ * charIndex(): Gives the slot of a char in a block's counts.
+ */
+static int charIndex(char agent) {
+
+    return AGENT_TYPE(agent) + 1;
+}
+
+
+/**
+ * blockChar(): Picks the most common char in a block, with ties going to
+ * the types in the order of AGENT_CHARS, then vacant.
+ */
+static char blockChar(const uint32_t counts[MAX_TYPES + 1]) {
+
+    int best = 1;  // Slot of the most common type so far
+
+    for (int k = 2; k <= MAX_TYPES; k++) {
+        if (counts[k] > counts[best]) {
+            best = k;
+        }
+    }
+
+    return counts[best] >= counts[0] ? AGENT_CHARS[best - 1] : '.';
+}
+
+
+/**
+ * screenRows(): Finds how many screen rows are left for the board once the
+ * status lines are taken out.
+ */
+static int screenRows(void) {
+
+    int rows = LINES - VIEWPORT_STATUS_LINES;
+    return rows > 1 ? rows : 1;
+}
+
+
+/**
+ * fitView(): Keeps as much of the board on screen as possible, works out how
+ * many blocks are shown, and makes room for their counts.
+ */
+static void fitView(Viewport *view) {
+
+    int dimensions = view->dimensions;
+    int zoom = view->zoom;
+    int maxTop = dimensions - screenRows() * zoom;
+    int maxLeft = dimensions - COLS * zoom;
+
+    // Don't scroll past the bottom or right edge, or off the top or left
+    if (view->top > maxTop) {
+        view->top = maxTop;
+    }
+    if (view->left > maxLeft) {
+        view->left = maxLeft;
+    }
+    if (view->top < 0) {
+        view->top = 0;
+    }
+    if (view->left < 0) {
+        view->left = 0;
+    }
+
+    // Blocks of the board past the top left corner, rounding up
+    int rows = (dimensions - view->top + zoom - 1) / zoom;
+    int cols = (dimensions - view->left + zoom - 1) / zoom;
+
+    view->rows = rows < screenRows() ? rows : screenRows();
+    view->cols = cols < COLS ? cols : COLS;
+
+    uint32_t (*blocks)[MAX_TYPES + 1] = realloc(view->blocks,
+                                                (size_t)view->rows *
+                                                view->cols * sizeof(*blocks));
+
+    // Show nothing rather than blocks there are no counts for
+    if (blocks == NULL) {
+        view->rows = 0;
+        view->cols = 0;
+        return;
+    }
+
+    view->blocks = blocks;
+}
+
+
+/**
+ * drawStatus(): Draws the status lines under the board and shows everything
+ * drawn so far.
+ */
+static void drawStatus(Viewport *view) {
+
+    move(view->rows, 0);
+    addstr(view->status);
+    refresh();
+}
+
+
+/**
+ * changeBlock(): Moves one cell of a block from one char to another and
+ * redraws the block if it is on screen.
+ */
+static void changeBlock(Viewport *view, size_t cell, char from, char to) {
+
+    int row = cell / view->dimensions - view->top;
+    int col = cell % view->dimensions - view->left;
+
+    // Skip cells that are above or to the left of the view
+    if (row < 0 || col < 0) {
+        return;
+    }
+
+    row /= view->zoom;
+    col /= view->zoom;
+
+    // Skip cells that are below or to the right of the view
+    if (row >= view->rows || col >= view->cols) {
+        return;
+    }
+
+    uint32_t *counts = view->blocks[(size_t)row * view->cols + col];
+    counts[charIndex(from)]--;
+    counts[charIndex(to)]++;
+
+    mvaddch(row, col, blockChar(counts));
+}
+
+
+/**
+ * initViewport(): Starts at full size in the top left corner, and sets up
+ * curses to read keys without waiting for a newline.
+ */
+void initViewport(Viewport *view, int dimensions) {
+
+    view->dimensions = dimensions;
+    view->zoom = 1;
+    view->top = 0;
+    view->left = 0;
+    view->blocks = NULL;
+    view->status[0] = '\0';
+
+    cbreak();  // Pass keys on as soon as they are pressed
+    noecho();  // Don't print the keys on the board
+    keypad(stdscr, TRUE);  // Turn the arrow keys into KEY_ codes
+
+    fitView(view);
+}
+
+
+/**
+ * freeViewport(): Frees the block counts.
+ */
+void freeViewport(Viewport *view) {
+
+    free(view->blocks);
+    view->blocks = NULL;
+}
+
+
+/**
+ * drawViewport(): Counts the chars of every block on screen one board row at
+ * a time, then draws the blocks and the status lines.
+ */
+void drawViewport(Viewport *view, int dimensions,
+                  char board[dimensions][dimensions]) {
+
+    int zoom = view->zoom;
+    int endRow = view->top + view->rows * zoom;
+    int endCol = view->left + view->cols * zoom;
+
+    // The last blocks can run off the bottom or right edge of the board
+    if (endRow > dimensions) {
+        endRow = dimensions;
+    }
+    if (endCol > dimensions) {
+        endCol = dimensions;
+    }
+
+    memset(view->blocks, 0, (size_t)view->rows * view->cols *
+                            sizeof(*view->blocks));
+
+    for (int i = view->top; i < endRow; i++) {
+        uint32_t (*blocks)[MAX_TYPES + 1] = view->blocks +
+                                (size_t)((i - view->top) / zoom) * view->cols;
+
+        for (int j = view->left; j < endCol; j++) {
+            blocks[(j - view->left) / zoom][charIndex(board[i][j])]++;
+        }
+    }
+
+    erase();  // Clear whatever the last view left behind
+
+    for (int row = 0; row < view->rows; row++) {
+        for (int col = 0; col < view->cols; col++) {
+            mvaddch(row, col,
+                    blockChar(view->blocks[(size_t)row * view->cols + col]));
+        }
+    }
+
+    drawStatus(view);
+}
+
+
+/**
+ * drawViewportChanges(): Takes each moved agent out of the block it left and
+ * adds it to the block it went to, in the order the moves were made,
+ * redrawing just those blocks.
+ */
+void drawViewportChanges(Viewport *view, const size_t *moveFrom,
+                         const size_t *moveTo, const char *moveAgent,
+                         size_t numMoves) {
+
+    for (size_t m = 0; m < numMoves; m++) {
+        changeBlock(view, moveFrom[m], moveAgent[m], '.');
+        changeBlock(view, moveTo[m], '.', moveAgent[m]);
+    }
+
+    drawStatus(view);
+}
+
+
+/**
+ * waitViewport(): Waits for keys until the time is up, handling each one as
+ * it comes in.
+ */
+void waitViewport(Viewport *view, int dimensions,
+                  char board[dimensions][dimensions], int microseconds) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double deadline = now.tv_sec * 1e3 + now.tv_nsec / 1e6 +
+                      microseconds / 1e3;
+
+    for (;;) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double remaining = deadline - (now.tv_sec * 1e3 + now.tv_nsec / 1e6);
+
+        if (remaining <= 0) {
+            timeout(0);  // Only take keys that have already been pressed
+        }
+        else {
+            timeout((int)remaining + 1);
+        }
+
+        int key = getch();
+
+        // Done once the time is up and no keys are left
+        if (key == ERR) {
+            if (remaining <= 0) {
+                return;
+            }
+            continue;
+        }
+
+        int rowStep = (view->rows * view->zoom + 3) / 4;
+        int colStep = (view->cols * view->zoom + 3) / 4;
+        int centerRow = view->top + view->rows * view->zoom / 2;
+        int centerCol = view->left + view->cols * view->zoom / 2;
+
+        switch (key) {
+        case KEY_UP:
+            view->top -= rowStep;
+            break;
+        case KEY_DOWN:
+            view->top += rowStep;
+            break;
+        case KEY_LEFT:
+            view->left -= colStep;
+            break;
+        case KEY_RIGHT:
+            view->left += colStep;
+            break;
+
+        // Zoom in or out around the center of the view, stopping at full
+        // size and once the whole board fits
+        case '+':
+        case '=':
+            if (view->zoom == 1) {
+                continue;
+            }
+            view->zoom /= 2;
+            view->top = centerRow - screenRows() * view->zoom / 2;
+            view->left = centerCol - COLS * view->zoom / 2;
+            break;
+        case '-':
+            if (view->top == 0 && view->left == 0 &&
+                view->rows * view->zoom >= dimensions &&
+                view->cols * view->zoom >= dimensions) {
+                continue;
+            }
+            view->zoom *= 2;
+            view->top = centerRow - screenRows() * view->zoom / 2;
+            view->left = centerCol - COLS * view->zoom / 2;
+            break;
+
+        // The terminal changed size, so the view has to be fit to it again
+        case KEY_RESIZE:
+            break;
+
+        default:
+            continue;
+        }
+
+        fitView(view);
+        drawViewport(view, dimensions, board);
+    }
+}
@@ -0,0 +1,115 @@
+//
+// File: viewport.h
+// Description: Provides the part of the board shown by infinite mode. The
+// view can be scrolled around boards larger than the terminal and zoomed
+// out, in which case each screen char stands for a square block of cells and
+// shows whichever char is most common in it. The number of each char in every
+// block on screen is kept, so after a cycle only the blocks the moves touched
+// are redrawn instead of the whole board.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for viewport.h
+#ifndef _VIEWPORT_H_
+#define _VIEWPORT_H_
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "agent_types.h"
+
+// Lines under the board used for the info about it
+#define VIEWPORT_STATUS_LINES 5
+
+// Room for the text of the info lines
+#define VIEWPORT_STATUS_SIZE 512
+
+
+/**
+ * Viewport holds where the view is on the board and the counts of the chars
+ * in each block of cells on screen.
+ */
+typedef struct {
+    int dimensions;                    // the size of the square board
+    int zoom;                          // cells per screen char on each side
+    int top;                           // first row of the board shown
+    int left;                          // first column of the board shown
+    int rows;                          // screen rows showing the board
+    int cols;                          // screen columns showing the board
+    uint32_t (*blocks)[MAX_TYPES + 1]; // vacant chars and chars of each
+                                       // type in each block on screen
+    char status[VIEWPORT_STATUS_SIZE]; // the info lines under the board
+} Viewport;
+
+
+/**
+ * initViewport shows the top left corner of the board at full size. Curses
+ * mode must already have been started.
+ *
+ * @param view        the viewport to initialize
+ * @param dimensions  the size of the square board
+ */
+void initViewport(Viewport *view, int dimensions);
+
+
+/**
+ * freeViewport releases the block counts of the viewport.
+ *
+ * @param view  the viewport to free
+ */
+void freeViewport(Viewport *view);
+
+
+/**
+ * drawViewport counts the chars in every block on screen and draws all of
+ * them, followed by the status lines.
+ *
+ * @param view        the viewport to draw
+ * @param dimensions  the size of the square 2D array given
+ * @param board       a 2D array of chars
+ */
+void drawViewport(Viewport *view, int dimensions,
+                  char board[dimensions][dimensions]);
+
+
+/**
+ * drawViewportChanges redraws only the blocks on screen that the moves of the
+ * last cycle touched, followed by the status lines. The viewport must have
+ * been drawn before the moves. An agent can move more than once in a cycle
+ * with UPDATE_ASYNC, so the agent of each move is given rather than read
+ * from the board.
+ *
+ * @param view       the viewport to draw
+ * @param moveFrom   the cells agents moved from
+ * @param moveTo     the cells agents moved to
+ * @param moveAgent  the agent that made each move
+ * @param numMoves   the number of moves in moveFrom, moveTo, and moveAgent
+ */
+void drawViewportChanges(Viewport *view, const size_t *moveFrom,
+                         const size_t *moveTo, const char *moveAgent,
+                         size_t numMoves);
+
+
+/**
+ * waitViewport waits for the given time while handling keys: the arrow keys
+ * scroll the view by a quarter of the screen, '+' zooms in and '-' zooms out.
+ * The whole view is drawn again whenever it moves.
+ *
+ * @param view          the viewport keys change
+ * @param dimensions    the size of the square 2D array given
+ * @param board         a 2D array of chars
+ * @param microseconds  how long to wait
+ */
+void waitViewport(Viewport *view, int dimensions,
+                  char board[dimensions][dimensions], int microseconds);
+
+
+// End include guard
+#endif
@@ -0,0 +1,107 @@
+//
+// File: work_list.c
+// Description: Contains the functions for the list of cells drawn from at
+// random. A cell's slot is only ever read after checking it against
+// WORK_LIST_ABSENT, so cells that were never added cost nothing to skip.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+#include "work_list.h"
+
+#include <stdlib.h>
+
+
+/**
+ * initWorkList(): Allocates the array of cells and the slot of every cell,
+ * marking them all absent.
+ */
+int initWorkList(WorkList *list, size_t size) {
+
+    list->size = size;
+    list->count = 0;
+    list->cells = malloc(size * sizeof(size_t));
+    list->slots = malloc(size * sizeof(size_t));
+
+    if (list->cells == NULL || list->slots == NULL) {
+        freeWorkList(list);
+        return 0;
+    }
+
+    for (size_t cell = 0; cell < size; cell++) {
+        list->slots[cell] = WORK_LIST_ABSENT;
+    }
+
+    return 1;
+}
+
+
+/**
+ * freeWorkList(): Frees the array of cells and their slots.
+ */
+void freeWorkList(WorkList *list) {
+
+    free(list->cells);
+    free(list->slots);
+
+    list->cells = NULL;
+    list->slots = NULL;
+    list->count = 0;
+}
+
+
+/**
+ * clearWorkList(): Marks only the cells in the list absent again.
+ */
+void clearWorkList(WorkList *list) {
+
+    for (size_t s = 0; s < list->count; s++) {
+        list->slots[list->cells[s]] = WORK_LIST_ABSENT;
+    }
+    list->count = 0;
+}
+
+
+/**
+ * workListInsert(): Puts the cell at the end of the array.
+ */
+void workListInsert(WorkList *list, size_t index) {
+
+    if (list->slots[index] != WORK_LIST_ABSENT) {
+        return;
+    }
+
+    list->slots[index] = list->count;
+    list->cells[list->count++] = index;
+}
+
+
+/**
+ * workListRemove(): Moves the last cell of the array into the removed cell's
+ * slot.
+ */
+void workListRemove(WorkList *list, size_t index) {
+
+    size_t slot = list->slots[index];
+
+    if (slot == WORK_LIST_ABSENT) {
+        return;
+    }
+
+    size_t last = list->cells[--list->count];
+
+    list->cells[slot] = last;
+    list->slots[last] = slot;
+    list->slots[index] = WORK_LIST_ABSENT;
+}
+
+
+/**
+ * workListPick(): Draws a slot in the packed part of the array.
+ */
+size_t workListPick(const WorkList *list, Rng *rng) {
+
+    return list->cells[rngBelow(rng, list->count)];
+}
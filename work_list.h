@@ -0,0 +1,102 @@
+//
+// File: work_list.h
+// Description: Provides a set of cells that one can be drawn from at random.
+// The cells are kept packed at the front of an array, and every cell also
+// knows its slot in that array, so a cell is added by putting it at the end
+// and removed by moving the last cell into its slot. Adding, removing, and
+// drawing a cell then take the same few steps however many cells there are,
+// though the order of the array depends on everything done to it so far.
+//
+// @author ldc1618: Luke Chelius
+//
+// // // // // // // // // // // // // // // // // // // // // // // // // //
+
+
+// Include guard for work_list.h
+#ifndef _WORK_LIST_H_
+#define _WORK_LIST_H_
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
+
+
+// Slot of a cell that is not in the list
+#define WORK_LIST_ABSENT SIZE_MAX
+
+
+/**
+ * WorkList is a set of cell indices in [0, size), where a cell's index is
+ * row * dimensions + col.
+ */
+typedef struct {
+    size_t size;     // number of cells covered
+    size_t count;    // cells in the list
+    size_t *cells;   // the cells in the list, packed at the front
+    size_t *slots;   // where each cell is in cells, or WORK_LIST_ABSENT
+} WorkList;
+
+
+/**
+ * initWorkList allocates an empty list able to hold the cells [0, size).
+ *
+ * @param list  the list to initialize
+ * @param size  the number of cells the list covers
+ * @returns     1 if the list was allocated, 0 if memory ran out
+ */
+int initWorkList(WorkList *list, size_t size);
+
+
+/**
+ * freeWorkList releases the memory held by a list.
+ *
+ * @param list  the list to free
+ */
+void freeWorkList(WorkList *list);
+
+
+/**
+ * clearWorkList removes every cell from a list, in time proportional to the
+ * number of cells in the list rather than the number of cells it covers.
+ *
+ * @param list  the list to clear
+ */
+void clearWorkList(WorkList *list);
+
+
+/**
+ * workListInsert adds a cell to a list if it isn't in it already.
+ *
+ * @param list   the list to add to
+ * @param index  the index of the cell to add
+ */
+void workListInsert(WorkList *list, size_t index);
+
+
+/**
+ * workListRemove removes a cell from a list if it is in it.
+ *
+ * @param list   the list to remove from
+ * @param index  the index of the cell to remove
+ */
+void workListRemove(WorkList *list, size_t index);
+
+
+/**
+ * workListPick draws one of the cells in a list, each equally likely,
+ * leaving it in the list.
+ *
+ * @param list  the list to draw from, which must not be empty
+ * @param rng   the generator to draw with
+ * @returns     the index of the cell drawn
+ */
+size_t workListPick(const WorkList *list, Rng *rng);
+
+
+// End include guard
+#endif